@@ -0,0 +1,133 @@
+#pragma once
+
+#include "shared-ptr/biased.h"
+#include "shared-ptr/pool.h"
+#include "shared-ptr/shared.h"
+#include "shared-ptr/weak.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Half a cache line of object, so a holder block shares its line with it
+struct Payload {
+    int64_t value = 0;
+    int64_t padding[3] = {};
+};
+
+// Uniform face over each pointer flavour for the benchmark templates
+template <typename Policy>
+struct OurShared {
+    using Shared = SharedPtr<Payload, Policy>;
+    using Weak = WeakPtr<Payload, Policy>;
+
+    static Shared Make() {
+        return MakeShared<Payload, Policy>();
+    }
+    static Shared Lock(const Weak& weak) {
+        return weak.Lock();
+    }
+};
+
+using Atomic = OurShared<AtomicRefCount>;
+using Packed = OurShared<PackedAtomicRefCount>;
+using SingleThreaded = OurShared<SingleThreadedRefCount>;
+using Biased = OurShared<BiasedRefCount>;
+
+struct Pooled : Atomic {
+    static Shared Make() {
+        return MakeSharedPooled<Payload>();
+    }
+};
+
+struct Aligned : Atomic {
+    static Shared Make() {
+        return MakeSharedAligned<Payload>();
+    }
+};
+
+struct StdShared {
+    using Shared = std::shared_ptr<Payload>;
+    using Weak = std::weak_ptr<Payload>;
+
+    static Shared Make() {
+        return std::make_shared<Payload>();
+    }
+    static Shared Lock(const Weak& weak) {
+        return weak.lock();
+    }
+};
+
+// The control block as it was before `ControlBlockOps`: virtual dispatch and
+// a virtual destructor, kept to measure what the ops table saves
+class VirtualSharedPtr {
+private:
+    struct Block {
+        std::atomic<size_t> shared_refs{1};
+
+        virtual ~Block() = default;
+        virtual void IfNoShared() noexcept = 0;
+    };
+    struct Holder : Block {
+        std::aligned_storage_t<sizeof(Payload), alignof(Payload)> storage;
+
+        Holder() {
+            new (&storage) Payload;
+        }
+        Payload* Get() noexcept {
+            return reinterpret_cast<Payload*>(&storage);
+        }
+        void IfNoShared() noexcept override {
+            Get()->~Payload();
+        }
+    };
+
+    Payload* ptr_ = nullptr;
+    Block* block_ = nullptr;
+
+public:
+    VirtualSharedPtr() noexcept = default;
+    VirtualSharedPtr(const VirtualSharedPtr& other) noexcept
+        : ptr_(other.ptr_), block_(other.block_) {
+        if (block_) {
+            block_->shared_refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    VirtualSharedPtr(VirtualSharedPtr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), block_(std::exchange(other.block_, nullptr)) {
+    }
+    VirtualSharedPtr& operator=(VirtualSharedPtr other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(block_, other.block_);
+        return *this;
+    }
+    ~VirtualSharedPtr() {
+        if (block_ && block_->shared_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            block_->IfNoShared();
+            delete block_;
+        }
+    }
+
+    static VirtualSharedPtr Make() {
+        auto holder = new Holder;
+        VirtualSharedPtr result;
+        result.ptr_ = holder->Get();
+        result.block_ = holder;
+        return result;
+    }
+
+    Payload* operator->() const noexcept {
+        return ptr_;
+    }
+};
+
+struct Virtual {
+    using Shared = VirtualSharedPtr;
+
+    static Shared Make() {
+        return VirtualSharedPtr::Make();
+    }
+};
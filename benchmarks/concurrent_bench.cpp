@@ -0,0 +1,150 @@
+#include "adapters.h"
+
+#include "shared-ptr/atomic_shared.h"
+#include "shared-ptr/snapshot.h"
+#include "shared-ptr/weak_cache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Set up by thread 0 before the threads start and reset after they're done
+template <typename Impl>
+typename Impl::Shared shared_owner;
+
+// Every thread copying and releasing owners of the same object
+template <typename Impl>
+void BM_CopyContended(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        shared_owner<Impl> = Impl::Make();
+    }
+    for (auto _ : state) {
+        typename Impl::Shared copy = shared_owner<Impl>;
+        benchmark::DoNotOptimize(copy);
+    }
+    if (state.thread_index() == 0) {
+        shared_owner<Impl> = typename Impl::Shared();
+    }
+}
+
+// Thread 0 keeps copying an owner while the others read the object: shows
+// what sharing a cache line between the counters and the object costs
+template <typename Impl>
+void BM_ReadWhileCounting(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        shared_owner<Impl> = Impl::Make();
+    }
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            typename Impl::Shared copy = shared_owner<Impl>;
+            benchmark::DoNotOptimize(copy);
+        } else {
+            int64_t value = shared_owner<Impl>->value;
+            benchmark::DoNotOptimize(value);
+        }
+    }
+    if (state.thread_index() == 0) {
+        shared_owner<Impl> = typename Impl::Shared();
+    }
+}
+
+#define CONTENDED_BENCHMARKS(Impl) \
+    BENCHMARK_TEMPLATE(BM_CopyContended, Impl)->ThreadRange(1, 64)->UseRealTime()
+
+CONTENDED_BENCHMARKS(StdShared);
+CONTENDED_BENCHMARKS(Atomic);
+CONTENDED_BENCHMARKS(Packed);
+CONTENDED_BENCHMARKS(Biased);
+CONTENDED_BENCHMARKS(Virtual);
+
+BENCHMARK_TEMPLATE(BM_ReadWhileCounting, Atomic)->ThreadRange(2, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ReadWhileCounting, Aligned)->ThreadRange(2, 64)->UseRealTime();
+
+// Readers of a published pointer, with a writer replacing it now and then
+AtomicSharedPtr<Payload> atomic_owner;
+std::shared_ptr<Payload> std_atomic_owner;
+SnapshotPtr<Payload> snapshot_owner;
+
+constexpr int64_t kStoreEvery = 1024;
+
+void BM_AtomicSharedPtrLoad(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        atomic_owner.Store(MakeShared<Payload>());
+    }
+    int64_t loads = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++loads % kStoreEvery == 0) {
+            atomic_owner.Store(MakeShared<Payload>());
+        }
+        SharedPtr<Payload> loaded = atomic_owner.Load();
+        benchmark::DoNotOptimize(loaded);
+    }
+    if (state.thread_index() == 0) {
+        atomic_owner.Store(SharedPtr<Payload>());
+    }
+}
+BENCHMARK(BM_AtomicSharedPtrLoad)->ThreadRange(1, 64)->UseRealTime();
+
+void BM_StdAtomicLoad(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        std::atomic_store(&std_atomic_owner, std::make_shared<Payload>());
+    }
+    int64_t loads = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++loads % kStoreEvery == 0) {
+            std::atomic_store(&std_atomic_owner, std::make_shared<Payload>());
+        }
+        std::shared_ptr<Payload> loaded = std::atomic_load(&std_atomic_owner);
+        benchmark::DoNotOptimize(loaded);
+    }
+    if (state.thread_index() == 0) {
+        std::atomic_store(&std_atomic_owner, std::shared_ptr<Payload>());
+    }
+}
+BENCHMARK(BM_StdAtomicLoad)->ThreadRange(1, 64)->UseRealTime();
+
+void BM_SnapshotRead(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        snapshot_owner.Publish(MakeShared<Payload>());
+    }
+    int64_t reads = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++reads % kStoreEvery == 0) {
+            snapshot_owner.Publish(MakeShared<Payload>());
+        }
+        auto guard = snapshot_owner.Read();
+        int64_t value = guard->value;
+        benchmark::DoNotOptimize(value);
+    }
+    if (state.thread_index() == 0) {
+        snapshot_owner.Publish(SharedPtr<Payload>());
+    }
+}
+BENCHMARK(BM_SnapshotRead)->ThreadRange(1, 64)->UseRealTime();
+
+// Hits on a small set of live values; thread 0 owns them
+constexpr int kCachedKeys = 256;
+WeakCache<int, Payload> weak_cache;
+std::vector<SharedPtr<Payload>> cached_values;
+
+void BM_WeakCacheFind(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        for (int key = 0; key < kCachedKeys; ++key) {
+            cached_values.push_back(weak_cache.GetOrCreate(key, [] {
+                return Payload();
+            }));
+        }
+    }
+    int key = state.thread_index();
+    for (auto _ : state) {
+        SharedPtr<Payload> found = weak_cache.Find(key);
+        benchmark::DoNotOptimize(found);
+        key = (key + 1) % kCachedKeys;
+    }
+    if (state.thread_index() == 0) {
+        cached_values.clear();
+    }
+}
+BENCHMARK(BM_WeakCacheFind)->ThreadRange(1, 64)->UseRealTime();
@@ -0,0 +1,119 @@
+#include "adapters.h"
+
+#include "shared-ptr/release.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Copy and release of an owner, the object staying alive
+template <typename Impl>
+void BM_Copy(benchmark::State& state) {
+    typename Impl::Shared owner = Impl::Make();
+    for (auto _ : state) {
+        typename Impl::Shared copy = owner;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+
+template <typename Impl>
+void BM_Move(benchmark::State& state) {
+    typename Impl::Shared first = Impl::Make();
+    typename Impl::Shared second;
+    for (auto _ : state) {
+        second = std::move(first);
+        first = std::move(second);
+        benchmark::DoNotOptimize(first);
+    }
+}
+
+// Allocation, construction and the last release
+template <typename Impl>
+void BM_Make(benchmark::State& state) {
+    for (auto _ : state) {
+        typename Impl::Shared owner = Impl::Make();
+        benchmark::DoNotOptimize(owner);
+    }
+}
+
+template <typename Impl>
+void BM_Lock(benchmark::State& state) {
+    typename Impl::Shared owner = Impl::Make();
+    typename Impl::Weak weak = owner;
+    for (auto _ : state) {
+        typename Impl::Shared locked = Impl::Lock(weak);
+        benchmark::DoNotOptimize(locked);
+    }
+}
+
+// The last release alone: a batch of objects made untimed, then destroyed
+template <typename Impl>
+void BM_LastRelease(benchmark::State& state) {
+    std::vector<typename Impl::Shared> owners(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (auto& owner : owners) {
+            owner = Impl::Make();
+        }
+        state.ResumeTiming();
+        for (auto& owner : owners) {
+            owner = typename Impl::Shared();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// `ReleaseAll` over the same batch, for `BM_LastRelease` to compare with
+template <typename Impl>
+void BM_ReleaseAll(benchmark::State& state) {
+    std::vector<typename Impl::Shared> owners(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (auto& owner : owners) {
+            owner = Impl::Make();
+        }
+        state.ResumeTiming();
+        ReleaseAll(owners.begin(), owners.end());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// `push_back` without `reserve`: dominated by moving owners on growth
+template <typename Impl>
+void BM_VectorGrowth(benchmark::State& state) {
+    typename Impl::Shared owner = Impl::Make();
+    for (auto _ : state) {
+        std::vector<typename Impl::Shared> owners;
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            owners.push_back(owner);
+        }
+        benchmark::DoNotOptimize(owners.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+#define SHARED_BENCHMARKS(Impl)                                          \
+    BENCHMARK_TEMPLATE(BM_Copy, Impl);                                  \
+    BENCHMARK_TEMPLATE(BM_Move, Impl);                                  \
+    BENCHMARK_TEMPLATE(BM_Make, Impl);                                  \
+    BENCHMARK_TEMPLATE(BM_Lock, Impl);                                  \
+    BENCHMARK_TEMPLATE(BM_LastRelease, Impl)->Arg(1 << 12);             \
+    BENCHMARK_TEMPLATE(BM_VectorGrowth, Impl)->Arg(1 << 10)
+
+SHARED_BENCHMARKS(StdShared);
+SHARED_BENCHMARKS(Atomic);
+SHARED_BENCHMARKS(Packed);
+SHARED_BENCHMARKS(SingleThreaded);
+SHARED_BENCHMARKS(Biased);
+SHARED_BENCHMARKS(Pooled);
+SHARED_BENCHMARKS(Aligned);
+
+BENCHMARK_TEMPLATE(BM_Copy, Virtual);
+BENCHMARK_TEMPLATE(BM_Make, Virtual);
+BENCHMARK_TEMPLATE(BM_LastRelease, Virtual)->Arg(1 << 12);
+
+BENCHMARK_TEMPLATE(BM_ReleaseAll, Atomic)->Arg(1 << 12);
+BENCHMARK_TEMPLATE(BM_ReleaseAll, Packed)->Arg(1 << 12);
+BENCHMARK_TEMPLATE(BM_ReleaseAll, Pooled)->Arg(1 << 12);
@@ -0,0 +1,101 @@
+#include "adapters.h"
+
+#include "unique-ptr/arena.h"
+#include "unique-ptr/unique.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct OurUnique {
+    using Unique = UniquePtr<Payload>;
+
+    static Unique Make() {
+        return MakeUnique<Payload>();
+    }
+    static void EndRequest() {
+    }
+};
+
+struct StdUnique {
+    using Unique = std::unique_ptr<Payload>;
+
+    static Unique Make() {
+        return std::make_unique<Payload>();
+    }
+    static void EndRequest() {
+    }
+};
+
+struct ArenaUnique {
+    using Unique = ArenaPtr<Payload>;
+
+    static Unique Make() {
+        return MakeUniqueIn<Payload>(Arena::ThreadLocal());
+    }
+    static void EndRequest() {
+        Arena::ThreadLocal().Reset();
+    }
+};
+
+template <typename Impl>
+void BM_UniqueMake(benchmark::State& state) {
+    for (auto _ : state) {
+        typename Impl::Unique owner = Impl::Make();
+        benchmark::DoNotOptimize(owner);
+    }
+}
+
+template <typename Impl>
+void BM_UniqueMove(benchmark::State& state) {
+    typename Impl::Unique first = Impl::Make();
+    typename Impl::Unique second;
+    for (auto _ : state) {
+        second = std::move(first);
+        first = std::move(second);
+        benchmark::DoNotOptimize(first);
+    }
+}
+
+// `push_back` without `reserve`; the objects are made once, untimed
+template <typename Impl>
+void BM_UniqueVectorGrowth(benchmark::State& state) {
+    std::vector<typename Impl::Unique> owners(static_cast<size_t>(state.range(0)));
+    for (auto& owner : owners) {
+        owner = Impl::Make();
+    }
+    for (auto _ : state) {
+        std::vector<typename Impl::Unique> grown;
+        for (auto& owner : owners) {
+            grown.push_back(std::move(owner));
+        }
+        benchmark::DoNotOptimize(grown.data());
+        owners.swap(grown);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// A request's worth of short-lived objects, then whatever ends a request
+template <typename Impl>
+void BM_UniqueRequest(benchmark::State& state) {
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            typename Impl::Unique owner = Impl::Make();
+            benchmark::DoNotOptimize(owner);
+        }
+        Impl::EndRequest();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_UniqueMake, StdUnique);
+BENCHMARK_TEMPLATE(BM_UniqueMake, OurUnique);
+BENCHMARK_TEMPLATE(BM_UniqueMove, StdUnique);
+BENCHMARK_TEMPLATE(BM_UniqueMove, OurUnique);
+BENCHMARK_TEMPLATE(BM_UniqueVectorGrowth, StdUnique)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_UniqueVectorGrowth, OurUnique)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_UniqueRequest, StdUnique)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_UniqueRequest, OurUnique)->Arg(1 << 10);
+BENCHMARK_TEMPLATE(BM_UniqueRequest, ArenaUnique)->Arg(1 << 10);
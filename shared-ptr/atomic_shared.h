@@ -0,0 +1,141 @@
+#pragma once
+
+#include "hazard.h"
+#include "shared.h"
+
+#include <atomic>
+#include <utility>
+
+// `SharedPtr` that can be read and replaced from many threads at once
+//
+// The current value sits in a heap holder published through one atomic
+// pointer. A reader protects the holder with a hazard pointer and copies the
+// value out; the atomic pointer itself is only ever read, so readers don't
+// bounce its cache line between cores. Writers swap in a new holder and
+// retire the old one, which is freed once no reader can still be copying it.
+template <typename T, typename Policy>
+class AtomicSharedPtr {
+private:
+    struct Holder {
+        SharedPtr<T, Policy> value;
+    };
+
+    std::atomic<Holder*> holder_;
+
+    static Holder* MakeHolder(SharedPtr<T, Policy> value) {
+        if (!value.ptr_ && !value.block_) {
+            return nullptr;
+        }
+        return new Holder{std::move(value)};
+    }
+
+    static bool Holds(const Holder* holder, const SharedPtr<T, Policy>& value) noexcept {
+        if (!holder) {
+            return !value.ptr_ && !value.block_;
+        }
+        return holder->value.ptr_ == value.ptr_ && holder->value.block_ == value.block_;
+    }
+
+    // `holder` must be unlinked already; readers may still be copying from it
+    static void Retire(Holder* holder) {
+        if (holder) {
+            HazardPointers::Retire(holder);
+        }
+    }
+    // The same, keeping the value: copied out, since it can't be moved from
+    // under the readers
+    static SharedPtr<T, Policy> Unlink(Holder* holder) {
+        if (!holder) {
+            return SharedPtr<T, Policy>();
+        }
+        SharedPtr<T, Policy> value = holder->value;
+        HazardPointers::Retire(holder);
+        return value;
+    }
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    AtomicSharedPtr() noexcept : holder_(nullptr) {
+    }
+    AtomicSharedPtr(SharedPtr<T, Policy> desired) : holder_(MakeHolder(std::move(desired))) {
+    }
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    // Destructor
+    ///////////////////////////////////////////////////////////////////////
+
+    ~AtomicSharedPtr() {
+        delete holder_.load(std::memory_order_acquire);
+    }
+
+    // Operations
+    ///////////////////////////////////////////////////////////////////////
+
+    SharedPtr<T, Policy> Load() const {
+        HazardPointers::Guard guard;
+        Holder* holder = guard.Protect(holder_);
+        if (!holder) {
+            return SharedPtr<T, Policy>();
+        }
+        return holder->value;
+    }
+    void Store(SharedPtr<T, Policy> desired) {
+        Holder* holder = MakeHolder(std::move(desired));
+        Retire(holder_.exchange(holder, std::memory_order_acq_rel));
+    }
+    SharedPtr<T, Policy> Exchange(SharedPtr<T, Policy> desired) {
+        Holder* holder = MakeHolder(std::move(desired));
+        return Unlink(holder_.exchange(holder, std::memory_order_acq_rel));
+    }
+
+    // Replaces the value if it has the same pointer and control block as
+    // `expected`; otherwise loads the current value into `expected`
+    bool CompareExchangeStrong(SharedPtr<T, Policy>& expected, SharedPtr<T, Policy> desired) {
+        return CompareExchange(expected, std::move(desired), false);
+    }
+    // As `CompareExchangeStrong`, but may fail if the value is replaced by an
+    // equal one concurrently
+    bool CompareExchangeWeak(SharedPtr<T, Policy>& expected, SharedPtr<T, Policy> desired) {
+        return CompareExchange(expected, std::move(desired), true);
+    }
+
+    operator SharedPtr<T, Policy>() const {
+        return Load();
+    }
+    AtomicSharedPtr& operator=(SharedPtr<T, Policy> desired) {
+        Store(std::move(desired));
+        return *this;
+    }
+
+private:
+    bool CompareExchange(SharedPtr<T, Policy>& expected, SharedPtr<T, Policy> desired,
+                         bool weak) {
+        Holder* desired_holder = nullptr;
+        HazardPointers::Guard guard;
+        while (true) {
+            Holder* current = guard.Protect(holder_);
+            if (!Holds(current, expected)) {
+                delete desired_holder;
+                expected = current ? current->value : SharedPtr<T, Policy>();
+                return false;
+            }
+            if (!desired_holder && (desired.ptr_ || desired.block_)) {
+                desired_holder = MakeHolder(std::move(desired));
+            }
+            if (holder_.compare_exchange_strong(current, desired_holder,
+                                                std::memory_order_acq_rel)) {
+                guard.Reset();
+                Retire(current);
+                return true;
+            }
+            if (weak) {
+                delete desired_holder;
+                expected = Load();
+                return false;
+            }
+        }
+    }
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Many holder blocks in one allocation
+//
+// Every element has a control block of its own and lives and dies on its own
+// terms; the batch memory counts the blocks still in it and is freed with the
+// last one.
+template <typename T, typename Policy = DefaultRefCount>
+struct ControlBlockBatchItem : ControlBlock<ControlBlockBatchItem<T, Policy>, Policy> {
+    class Batch;
+    struct GenerateTag {};
+
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+    Batch* batch_;
+
+    template <typename... Args>
+    explicit ControlBlockBatchItem(Batch* batch, Args&&... args) : batch_(batch) {
+        new (&storage_) T{std::forward<Args>(args)...};
+    }
+    // From whatever `make()` returns, without a move in between
+    template <typename Make>
+    ControlBlockBatchItem(GenerateTag, Batch* batch, Make& make, size_t index) : batch_(batch) {
+        new (&storage_) T(make(index));
+    }
+
+    void IfNoShared() noexcept {
+        Get()->~T();
+    }
+
+    void Deallocate() noexcept {
+        Batch* batch = batch_;
+        this->~ControlBlockBatchItem();
+        batch->Release();
+    }
+
+    T* Get() {
+        return reinterpret_cast<T*>(&storage_);
+    }
+};
+
+template <typename T, typename Policy>
+class ControlBlockBatchItem<T, Policy>::Batch {
+private:
+    using Item = ControlBlockBatchItem;
+
+    typename Policy::Counter items_;
+
+    static constexpr size_t kAlignment = alignof(Item) > alignof(typename Policy::Counter)
+                                             ? alignof(Item)
+                                             : alignof(typename Policy::Counter);
+    static constexpr bool kOverAligned = kAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    static constexpr size_t ItemsOffset() noexcept {
+        return (sizeof(Batch) + alignof(Item) - 1) / alignof(Item) * alignof(Item);
+    }
+
+    // Counts one reference for the builder until `Build` is done
+    Batch() noexcept : items_(1) {
+    }
+
+    Item* Items() noexcept {
+        return reinterpret_cast<Item*>(reinterpret_cast<char*>(this) + ItemsOffset());
+    }
+
+public:
+    void Release() noexcept {
+        if (items_.Decrement()) {
+            this->~Batch();
+            if constexpr (kOverAligned) {
+                ::operator delete(this, std::align_val_t{kAlignment});
+            } else {
+                ::operator delete(this);
+            }
+        }
+    }
+
+    // Constructs `count` items by calling `construct(batch, memory, index)`
+    template <typename Construct>
+    static std::vector<SharedPtr<T, Policy>> Build(size_t count, Construct construct) {
+        if (count > (SIZE_MAX - ItemsOffset()) / sizeof(Item)) {
+            throw std::bad_array_new_length();
+        }
+        std::vector<SharedPtr<T, Policy>> result;
+        result.reserve(count);
+        void* memory;
+        if constexpr (kOverAligned) {
+            memory = ::operator new(ItemsOffset() + count * sizeof(Item),
+                                    std::align_val_t{kAlignment});
+        } else {
+            memory = ::operator new(ItemsOffset() + count * sizeof(Item));
+        }
+        auto batch = new (memory) Batch;
+        Item* items = batch->Items();
+        try {
+            for (size_t i = 0; i < count; ++i) {
+                construct(batch, items + i, i);
+                batch->items_.Increment();
+                result.emplace_back(kAdoptNew, items[i].Get(), items + i);
+            }
+        } catch (...) {
+            // Drops the elements made so far
+            result.clear();
+            batch->Release();
+            throw;
+        }
+        batch->Release();
+        return result;
+    }
+};
+
+// `count` objects made from `args` and laid out next to each other
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+std::vector<SharedPtr<T, Policy>> MakeSharedN(size_t count, const Args&... args) {
+    using Item = ControlBlockBatchItem<T, Policy>;
+    return Item::Batch::Build(count, [&](typename Item::Batch* batch, Item* memory, size_t) {
+        new (memory) Item(batch, args...);
+    });
+}
+
+// The same, element `i` being made from `make(i)`
+template <typename T, typename Policy = DefaultRefCount, typename Make>
+std::vector<SharedPtr<T, Policy>> MakeSharedGenerate(size_t count, Make make) {
+    using Item = ControlBlockBatchItem<T, Policy>;
+    return Item::Batch::Build(count, [&](typename Item::Batch* batch, Item* memory, size_t i) {
+        new (memory) Item(typename Item::GenerateTag{}, batch, make, i);
+    });
+}
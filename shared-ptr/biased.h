@@ -0,0 +1,286 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Biased reference counting
+//
+// The thread creating a block owns its "biased" shared counter and updates
+// it without atomics; every other thread uses an atomic counter, which may
+// go negative when references made by the owner are dropped elsewhere. The
+// two are merged once the owner drops its last reference, or when another
+// thread finds the atomic counter negative and queues the block to the owner.
+//
+// Queued blocks are merged, and possibly destroyed, on the owner's next
+// reference operation, at `MergeQueued()` or when the owner exits; a thread
+// that hands objects off and then idles should call `MergeQueued()` from its
+// loop. Per-thread bookkeeping lives until the thread and all the blocks it
+// still owns are gone.
+//
+// Away from the owner, a queued block whose atomic counter is not positive
+// can't be told live from dead, so `WeakPtr::Lock()` there fails until the
+// owner merges it rather than bring back an object that may be gone.
+struct BiasedRefCount {
+    using Counter = AtomicRefCount::Counter;
+
+    class RefCounts;
+
+    // Merges the blocks other threads have queued to the calling thread
+    static void MergeQueued() noexcept;
+
+private:
+    struct Owner {
+        // Blocks queued for merging, linked through `next_queued_`; `Closed()`
+        // once the thread is gone
+        std::atomic<RefCounts*> queue{nullptr};
+        // Unmerged or queued blocks plus one for the thread itself
+        std::atomic<size_t> refs{1};
+
+        void Release() noexcept {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+    };
+
+    static RefCounts* Closed() noexcept {
+        static char sentinel;
+        return reinterpret_cast<RefCounts*>(&sentinel);
+    }
+
+    struct OwnerHandle {
+        Owner* owner = new Owner;
+
+        OwnerHandle() {
+            local_owner = owner;
+        }
+        ~OwnerHandle();
+    };
+
+    static inline thread_local Owner* local_owner = nullptr;
+    static inline thread_local bool torn_down = false;
+
+    static Owner* LocalOwner() noexcept {
+        if (!local_owner && !torn_down) {
+            thread_local OwnerHandle handle;
+        }
+        return local_owner;
+    }
+
+    static void Drain(Owner* owner, RefCounts* queued) noexcept;
+
+public:
+    class RefCounts {
+    private:
+        // The atomic counter is kept shifted left past two flag bits
+        static constexpr int64_t kMerged = 1;
+        static constexpr int64_t kQueued = 2;
+        static constexpr int64_t kOne = 4;
+
+        std::atomic<Owner*> owner_;
+        size_t biased_;
+        std::atomic<int64_t> shared_;
+        std::atomic<size_t> weak_refs_{1};
+        RefCounts* next_queued_ = nullptr;
+
+        friend struct BiasedRefCount;
+
+        static int64_t Count(int64_t shared) noexcept {
+            return (shared - (shared & (kMerged | kQueued))) / kOne;
+        }
+
+        // Owner side: the biased counter is valid until the block is merged,
+        // which sets `owner_` to null
+        Owner* OwnedByThisThread() noexcept {
+            Owner* owner = LocalOwner();
+            if (!owner) {
+                return nullptr;
+            }
+            RefCounts* queued = owner->queue.load(std::memory_order_relaxed);
+            if (queued && queued != Closed()) {
+                MergeQueued();
+            }
+            return owner_.load(std::memory_order_relaxed) == owner ? owner : nullptr;
+        }
+
+        // Moves the biased count into the atomic one; returns `true` if
+        // nothing refers to the object anymore
+        bool Merge() noexcept {
+            int64_t biased = static_cast<int64_t>(biased_);
+            biased_ = 0;
+            int64_t shared = shared_.fetch_add(biased * kOne + kMerged, std::memory_order_acq_rel);
+            // Whoever sees the owner gone also sees the merged counter
+            Owner* owner = owner_.exchange(nullptr, std::memory_order_acq_rel);
+            // A queued block keeps its owner until it leaves the queue
+            if (!(shared & kQueued)) {
+                owner->Release();
+            }
+            return Count(shared) + biased == 0;
+        }
+
+        void Enqueue(Owner* owner) noexcept;
+        void MergeFromQueue(Owner* owner) noexcept;
+        void ReleaseQueueRef() noexcept;
+
+    public:
+        RefCounts() noexcept : owner_(LocalOwner()) {
+            Owner* owner = owner_.load(std::memory_order_relaxed);
+            if (owner) {
+                owner->refs.fetch_add(1, std::memory_order_relaxed);
+            }
+            biased_ = owner ? 1 : 0;
+            shared_.store(owner ? 0 : kOne + kMerged, std::memory_order_relaxed);
+        }
+
+        void IncrementShared() noexcept {
+            if (OwnedByThisThread()) {
+                ++biased_;
+            } else {
+                shared_.fetch_add(kOne, std::memory_order_relaxed);
+            }
+        }
+        bool TryIncrementShared() noexcept {
+            if (OwnedByThisThread()) {
+                ++biased_;
+                return true;
+            }
+            int64_t shared = shared_.load(std::memory_order_relaxed);
+            do {
+                // Unmerged and unqueued means the owner still holds a biased
+                // reference; a queued block may have none left
+                if (Count(shared) <= 0 && (shared & (kMerged | kQueued))) {
+                    return false;
+                }
+            } while (!shared_.compare_exchange_weak(shared, shared + kOne,
+                                                    std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed));
+            return true;
+        }
+        bool DecrementShared() noexcept {
+            if (OwnedByThisThread()) {
+                return --biased_ == 0 && Merge();
+            }
+            Owner* owner = owner_.load(std::memory_order_acquire);
+            int64_t shared = shared_.load(std::memory_order_relaxed);
+            int64_t next;
+            bool enqueue;
+            bool pinned = false;
+            do {
+                next = shared - kOne;
+                enqueue = !(shared & (kMerged | kQueued)) && Count(next) < 0;
+                if (enqueue) {
+                    next |= kQueued;
+                    // The queue's reference, taken while this one still
+                    // keeps the block: once queued, the owner may end it
+                    if (!pinned) {
+                        IncrementWeak();
+                        pinned = true;
+                    }
+                }
+            } while (!shared_.compare_exchange_weak(shared, next, std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed));
+            if (enqueue) {
+                // Only a merge done by the owner can end the object now; the
+                // owner stays until the block leaves its queue
+                Enqueue(owner);
+                return false;
+            }
+            if (pinned) {
+                ReleaseQueueRef();
+            }
+            return (next & kMerged) && Count(next) == 0;
+        }
+
+        void IncrementWeak() noexcept {
+            weak_refs_.fetch_add(1, std::memory_order_relaxed);
+        }
+        bool DecrementWeak() noexcept {
+            return weak_refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        bool IsLastReference() const noexcept {
+            return false;
+        }
+        // Exact on the owner thread and once merged; elsewhere it tells a live
+        // object from a dead one and never reports a sole owner
+        size_t SharedCount() const noexcept {
+            int64_t shared = shared_.load(std::memory_order_acquire);
+            int64_t count = Count(shared);
+            if (shared & kMerged) {
+                return static_cast<size_t>(count);
+            }
+            if (owner_.load(std::memory_order_relaxed) == local_owner && local_owner) {
+                return static_cast<size_t>(count + static_cast<int64_t>(biased_));
+            }
+            return static_cast<size_t>(count > 1 ? count : 1) + 1;
+        }
+    };
+};
+
+// The block carries a weak reference for the queue
+inline void BiasedRefCount::RefCounts::Enqueue(Owner* owner) noexcept {
+    RefCounts* head = owner->queue.load(std::memory_order_acquire);
+    do {
+        if (head == Closed()) {
+            // The owner is gone; its writes were published by closing
+            MergeFromQueue(owner);
+            return;
+        }
+        next_queued_ = head;
+    } while (!owner->queue.compare_exchange_weak(head, this, std::memory_order_acq_rel,
+                                                 std::memory_order_acquire));
+}
+
+// The block may have been merged by the owner since it was queued
+inline void BiasedRefCount::RefCounts::MergeFromQueue(Owner* owner) noexcept {
+    auto block = static_cast<ControlBlockBase<BiasedRefCount>*>(this);
+    bool dead = !(shared_.load(std::memory_order_relaxed) & kMerged) && Merge();
+    if (dead) {
+        block->IfNoShared();
+        block->ReleaseWeak();
+    }
+    owner->Release();
+    block->ReleaseWeak();
+}
+
+// Drops a queue reference taken for nothing; it may be the block's last
+inline void BiasedRefCount::RefCounts::ReleaseQueueRef() noexcept {
+    static_cast<ControlBlockBase<BiasedRefCount>*>(this)->ReleaseWeak();
+}
+
+inline void BiasedRefCount::Drain(Owner* owner, RefCounts* queued) noexcept {
+    while (queued) {
+        RefCounts* next = queued->next_queued_;
+        queued->MergeFromQueue(owner);
+        queued = next;
+    }
+}
+
+// Merging may destroy objects that queue more blocks, so it runs until the
+// queue stays empty
+inline void BiasedRefCount::MergeQueued() noexcept {
+    Owner* owner = LocalOwner();
+    if (!owner) {
+        return;
+    }
+    RefCounts* queued = owner->queue.load(std::memory_order_relaxed);
+    while (queued && queued != Closed()) {
+        if (owner->queue.compare_exchange_weak(queued, nullptr, std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            Drain(owner, queued);
+            queued = owner->queue.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// The thread stops owning anything before the last merge: objects destroyed
+// there take the shared path, and blocks they queue are merged at once
+inline BiasedRefCount::OwnerHandle::~OwnerHandle() {
+    local_owner = nullptr;
+    torn_down = true;
+    Drain(owner, owner->queue.exchange(Closed(), std::memory_order_acq_rel));
+    owner->Release();
+}
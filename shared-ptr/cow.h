@@ -0,0 +1,82 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Copy-on-write value: copies share one object, and the first `Write()`
+// through a copy that isn't alone clones it
+//
+// Reading costs nothing beyond the pointer. The object lives in a holder
+// block made by `MakeShared` and never handed out as a `SharedPtr`, so no
+// `WeakPtr` can bring back an owner behind the uniqueness check; a count of
+// one, loaded with acquire, then means the other owners are gone and their
+// reads done. `T` must not derive from `EnableSharedFromThis`.
+template <typename T, typename Policy = DefaultRefCount>
+class CowPtr {
+private:
+    static_assert(!std::is_array_v<T>, "CowPtr holds a single object");
+
+    SharedPtr<T, Policy> ptr_;
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    CowPtr() noexcept = default;
+    template <typename... Args>
+    explicit CowPtr(std::in_place_t, Args&&... args)
+        : ptr_(MakeShared<T, Policy>(std::forward<Args>(args)...)) {
+    }
+
+    // Modifiers
+    ///////////////////////////////////////////////////////////////////////
+
+    // The object to modify, cloned first unless this is its only owner, or
+    // value-initialized if there is none; writes through the reference must
+    // stop once this pointer is copied
+    T& Write() {
+        if (!ptr_) {
+            ptr_ = MakeShared<T, Policy>();
+        } else if (!IsUnique()) {
+            ptr_ = MakeShared<T, Policy>(std::as_const(*ptr_));
+        }
+        return *ptr_;
+    }
+    void Reset() noexcept {
+        ptr_.Reset();
+    }
+    void Swap(CowPtr& other) noexcept {
+        ptr_.Swap(other.ptr_);
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    const T* Get() const noexcept {
+        return ptr_.Get();
+    }
+    const T& operator*() const noexcept {
+        return *ptr_;
+    }
+    const T* operator->() const noexcept {
+        return ptr_.Get();
+    }
+    size_t UseCount() const noexcept {
+        return ptr_.UseCount();
+    }
+    // `true` if `Write()` would not clone
+    bool IsUnique() const noexcept {
+        return ptr_.UseCount() == 1;
+    }
+    explicit operator bool() const noexcept {
+        return static_cast<bool>(ptr_);
+    }
+};
+
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+CowPtr<T, Policy> MakeCow(Args&&... args) {
+    return CowPtr<T, Policy>(std::in_place, std::forward<Args>(args)...);
+}
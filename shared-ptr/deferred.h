@@ -0,0 +1,74 @@
+#pragma once
+
+#include "release.h"
+#include "shared.h"
+#include "../unique-ptr/reclaimer.h"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Holder whose object is destroyed on the reclaimer thread; the block stays
+// alive, through a weak reference of its own, until that's done
+template <typename T, typename Policy = DefaultRefCount>
+struct ControlBlockDeferredHolder : ControlBlock<ControlBlockDeferredHolder<T, Policy>, Policy> {
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+    Reclaimer* reclaimer_;
+
+    template <typename... Args>
+    explicit ControlBlockDeferredHolder(Reclaimer* reclaimer, Args&&... args)
+        : reclaimer_(reclaimer) {
+        new (&storage_) T{std::forward<Args>(args)...};
+    }
+
+    void IfNoShared() noexcept {
+        this->IncrementWeak();
+        DeferDestroy();
+    }
+    // The owners' weak reference passes on to the task, which frees the block
+    void IfLastReference() noexcept {
+        DeferDestroy();
+    }
+
+    T* Get() {
+        return reinterpret_cast<T*>(&storage_);
+    }
+
+private:
+    // Destroys the object, then drops a weak reference
+    void DeferDestroy() noexcept {
+        reclaimer_->Defer(this, [](void* deferred) noexcept {
+            auto block = static_cast<ControlBlockDeferredHolder*>(deferred);
+            block->Get()->~T();
+            block->ReleaseWeak();
+        });
+    }
+};
+
+// `MakeShared` whose object is destroyed on `reclaimer` once unreferenced
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+SharedPtr<T, Policy> MakeSharedDeferredIn(Reclaimer& reclaimer, Args&&... args) {
+    auto holder_block =
+        new ControlBlockDeferredHolder<T, Policy>(&reclaimer, std::forward<Args>(args)...);
+    return SharedPtr<T, Policy>(kAdoptNew, holder_block->Get(), holder_block);
+}
+
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+SharedPtr<T, Policy> MakeSharedDeferred(Args&&... args) {
+    return MakeSharedDeferredIn<T, Policy>(Reclaimer::Default(), std::forward<Args>(args)...);
+}
+
+// Empties `pointers` at once and runs their `ReleaseAll()` on `reclaimer`
+template <typename T, typename Policy, typename Alloc>
+void ReleaseAllDeferred(std::vector<SharedPtr<T, Policy>, Alloc>& pointers,
+                        Reclaimer& reclaimer = Reclaimer::Default()) {
+    using Vector = std::vector<SharedPtr<T, Policy>, Alloc>;
+    auto released = new Vector(std::move(pointers));
+    pointers.clear();
+    reclaimer.Defer(released, [](void* deferred) noexcept {
+        auto vector = static_cast<Vector*>(deferred);
+        ReleaseAll(*vector);
+        delete vector;
+    });
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Hazard pointers for deferred reclamation
+//
+// A reader publishes the pointer it is about to dereference in a slot of its
+// own and re-checks the source; a writer that unlinks an object retires it,
+// and the object is reclaimed only once no slot holds it. Readers write to
+// nothing but their own slot, so they don't contend with each other.
+class HazardPointers {
+private:
+    struct alignas(64) Slot {
+        std::atomic<const void*> ptr{nullptr};
+        std::atomic<bool> in_use{true};
+        Slot* next = nullptr;
+    };
+
+public:
+    // Owns one slot for as long as it lives
+    class Guard {
+    private:
+        Slot* slot_;
+
+    public:
+        Guard() : slot_(AcquireSlot()) {
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() {
+            ReleaseSlot(slot_);
+        }
+
+        // Loads `source`; the result stays valid until `Reset()` or the end of
+        // the guard even if a writer retires it meanwhile
+        template <typename T>
+        T* Protect(const std::atomic<T*>& source) noexcept {
+            T* ptr = source.load(std::memory_order_relaxed);
+            while (true) {
+                slot_->ptr.store(ptr, std::memory_order_seq_cst);
+                T* current = source.load(std::memory_order_seq_cst);
+                if (current == ptr) {
+                    return ptr;
+                }
+                ptr = current;
+            }
+        }
+        void Reset() noexcept {
+            slot_->ptr.store(nullptr, std::memory_order_release);
+        }
+    };
+
+    // `reclaim(ptr)` is called once no guard protects `ptr`
+    static void Retire(void* ptr, void (*reclaim)(void*)) {
+        ThreadState* state = LocalState();
+        if (!state) {
+            Domain& domain = GetDomain();
+            std::lock_guard<std::mutex> guard(domain.mutex);
+            domain.orphans.push_back({ptr, reclaim});
+            domain.has_orphans.store(true, std::memory_order_relaxed);
+            return;
+        }
+        state->retired.push_back({ptr, reclaim});
+        if (state->retired.size() >= ScanThreshold()) {
+            Scan(*state);
+        }
+    }
+    template <typename T>
+    static void Retire(T* ptr) {
+        Retire(const_cast<void*>(static_cast<const void*>(ptr)), [](void* retired) {
+            delete static_cast<T*>(retired);
+        });
+    }
+
+    // Reclaims whatever the calling thread has retired and is not protected
+    static void Reclaim() {
+        if (ThreadState* state = LocalState()) {
+            Scan(*state);
+        }
+    }
+
+private:
+    struct Retired {
+        void* ptr;
+        void (*reclaim)(void*);
+    };
+
+    struct Domain {
+        std::atomic<Slot*> slots{nullptr};
+        std::atomic<size_t> slot_count{0};
+        std::mutex mutex;
+        // Retired by threads that are gone, reclaimed by whoever scans next
+        std::vector<Retired> orphans;
+        std::atomic<bool> has_orphans{false};
+    };
+
+    static Domain& GetDomain() {
+        // Never destroyed: objects may be retired during static destruction
+        static Domain* domain = new Domain;
+        return *domain;
+    }
+
+    struct ThreadState {
+        std::vector<Slot*> free_slots;
+        std::vector<Retired> retired;
+    };
+
+    struct StateHandle {
+        ThreadState state;
+
+        StateHandle() {
+            local_state = &state;
+        }
+        ~StateHandle() {
+            for (Slot* slot : state.free_slots) {
+                slot->in_use.store(false, std::memory_order_release);
+            }
+            state.free_slots.clear();
+            Scan(state);
+            local_state = nullptr;
+            torn_down = true;
+            Domain& domain = GetDomain();
+            std::lock_guard<std::mutex> guard(domain.mutex);
+            domain.orphans.insert(domain.orphans.end(), state.retired.begin(),
+                                  state.retired.end());
+            domain.has_orphans.store(!domain.orphans.empty(), std::memory_order_relaxed);
+        }
+    };
+
+    static inline thread_local ThreadState* local_state = nullptr;
+    static inline thread_local bool torn_down = false;
+
+    // `nullptr` once the thread is past its `thread_local` teardown
+    static ThreadState* LocalState() {
+        if (!local_state && !torn_down) {
+            thread_local StateHandle handle;
+        }
+        return local_state;
+    }
+
+    static size_t ScanThreshold() noexcept {
+        size_t slots = GetDomain().slot_count.load(std::memory_order_relaxed);
+        return std::max<size_t>(64, 2 * slots);
+    }
+
+    static Slot* AcquireSlot() {
+        ThreadState* state = LocalState();
+        if (state && !state->free_slots.empty()) {
+            Slot* slot = state->free_slots.back();
+            state->free_slots.pop_back();
+            return slot;
+        }
+        Domain& domain = GetDomain();
+        for (Slot* slot = domain.slots.load(std::memory_order_acquire); slot;
+             slot = slot->next) {
+            bool in_use = false;
+            if (!slot->in_use.load(std::memory_order_relaxed) &&
+                slot->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        auto slot = new Slot;
+        slot->next = domain.slots.load(std::memory_order_relaxed);
+        while (!domain.slots.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+        }
+        domain.slot_count.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    // Slots stay with their thread until it exits
+    static void ReleaseSlot(Slot* slot) {
+        slot->ptr.store(nullptr, std::memory_order_release);
+        if (ThreadState* state = LocalState()) {
+            state->free_slots.push_back(slot);
+        } else {
+            slot->in_use.store(false, std::memory_order_release);
+        }
+    }
+
+    static void Scan(ThreadState& state) {
+        Domain& domain = GetDomain();
+        std::vector<Retired> candidates;
+        candidates.swap(state.retired);
+        if (domain.has_orphans.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> guard(domain.mutex);
+            candidates.insert(candidates.end(), domain.orphans.begin(), domain.orphans.end());
+            domain.orphans.clear();
+            domain.has_orphans.store(false, std::memory_order_relaxed);
+        }
+
+        std::vector<const void*> hazards;
+        for (Slot* slot = domain.slots.load(std::memory_order_acquire); slot;
+             slot = slot->next) {
+            if (const void* ptr = slot->ptr.load(std::memory_order_seq_cst)) {
+                hazards.push_back(ptr);
+            }
+        }
+        std::sort(hazards.begin(), hazards.end());
+
+        // Reclaiming may retire more objects, so `state.retired` is only
+        // appended to from here on
+        std::vector<Retired> unprotected;
+        for (const Retired& retired : candidates) {
+            if (std::binary_search(hazards.begin(), hazards.end(), retired.ptr)) {
+                state.retired.push_back(retired);
+            } else {
+                unprotected.push_back(retired);
+            }
+        }
+        for (const Retired& retired : unprotected) {
+            retired.reclaim(retired.ptr);
+        }
+    }
+};
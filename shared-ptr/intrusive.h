@@ -0,0 +1,179 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <utility>
+
+// Embeds the reference count into `Derived`
+//
+// `IntrusivePtr` finds the count through the `IntrusiveAddRef` and
+// `IntrusiveRelease` hooks, looked up by ADL; types with a count of their own
+// can define the hooks instead of deriving from `RefCounted`.
+template <typename Derived, typename Policy = DefaultRefCount>
+class RefCounted {
+private:
+    mutable typename Policy::Counter refs_;
+
+public:
+    RefCounted() noexcept = default;
+    // A copy is a new object, nobody refers to it yet
+    RefCounted(const RefCounted&) noexcept {
+    }
+    RefCounted& operator=(const RefCounted&) noexcept {
+        return *this;
+    }
+
+    size_t UseCount() const noexcept {
+        return refs_.Get();
+    }
+
+    friend void IntrusiveAddRef(const Derived* ptr) noexcept {
+        static_cast<const RefCounted*>(ptr)->refs_.Increment();
+    }
+    friend void IntrusiveRelease(const Derived* ptr) noexcept {
+        if (static_cast<const RefCounted*>(ptr)->refs_.Decrement()) {
+            delete ptr;
+        }
+    }
+
+protected:
+    ~RefCounted() = default;
+};
+
+// One-word owning pointer to an object carrying its own reference count
+template <typename T>
+class IntrusivePtr {
+private:
+    T* ptr_;
+
+    template <typename Y>
+    friend class IntrusivePtr;
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    IntrusivePtr() noexcept : ptr_(nullptr) {
+    }
+    IntrusivePtr(std::nullptr_t) noexcept : ptr_(nullptr) {
+    }
+    // Safe for any live object, `this` included: the count travels with it
+    template <typename Y>
+    explicit IntrusivePtr(Y* ptr) noexcept : ptr_(ptr) {
+        if (ptr_) {
+            IntrusiveAddRef(ptr_);
+        }
+    }
+    // Takes over a reference already counted in `*ptr`
+    template <typename Y>
+    IntrusivePtr(AdoptRefTag, Y* ptr) noexcept : ptr_(ptr) {
+    }
+    IntrusivePtr(const IntrusivePtr& other) noexcept : IntrusivePtr(other.ptr_) {
+    }
+    template <typename Y>
+    IntrusivePtr(const IntrusivePtr<Y>& other) noexcept : IntrusivePtr(other.ptr_) {
+    }
+    IntrusivePtr(IntrusivePtr&& other) noexcept : ptr_(other.ptr_) {
+        other.ptr_ = nullptr;
+    }
+    template <typename Y>
+    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept : ptr_(other.ptr_) {
+        other.ptr_ = nullptr;
+    }
+
+    // `operator=`-s
+    ///////////////////////////////////////////////////////////////////////
+
+    IntrusivePtr& operator=(const IntrusivePtr& other) noexcept {
+        IntrusivePtr<T>(other).Swap(*this);
+        return *this;
+    }
+    template <typename Y>
+    IntrusivePtr& operator=(const IntrusivePtr<Y>& other) noexcept {
+        IntrusivePtr<T>(other).Swap(*this);
+        return *this;
+    }
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
+        IntrusivePtr<T>(std::move(other)).Swap(*this);
+        return *this;
+    }
+    template <typename Y>
+    IntrusivePtr& operator=(IntrusivePtr<Y>&& other) noexcept {
+        IntrusivePtr<T>(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    // Destructor
+    ///////////////////////////////////////////////////////////////////////
+
+    ~IntrusivePtr() {
+        if (ptr_) {
+            IntrusiveRelease(ptr_);
+        }
+    }
+
+    // Modifiers
+    ///////////////////////////////////////////////////////////////////////
+
+    void Reset() noexcept {
+        IntrusivePtr().Swap(*this);
+    }
+    template <typename Y>
+    void Reset(Y* ptr) noexcept {
+        IntrusivePtr<T>(ptr).Swap(*this);
+    }
+    void Swap(IntrusivePtr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+    }
+    // Gives up the pointer without dropping its reference
+    T* Detach() noexcept {
+        T* ptr = ptr_;
+        ptr_ = nullptr;
+        return ptr;
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    T* Get() const noexcept {
+        return ptr_;
+    }
+    T& operator*() const noexcept {
+        return *ptr_;
+    }
+    T* operator->() const noexcept {
+        return ptr_;
+    }
+    explicit operator bool() const noexcept {
+        return ptr_ != nullptr;
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const IntrusivePtr<T>& left, const IntrusivePtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename... Args>
+IntrusivePtr<T> MakeIntrusive(Args&&... args) {
+    return IntrusivePtr<T>(new T{std::forward<Args>(args)...});
+}
+
+// Drops the intrusive reference held by a `SharedPtr` made by `ToShared`
+struct IntrusiveReleaser {
+    template <typename T>
+    void operator()(T* ptr) const noexcept {
+        IntrusiveRelease(ptr);
+    }
+};
+
+// Hands an intrusively counted object to code expecting `SharedPtr`; the
+// whole `SharedPtr` owns one intrusive reference
+template <typename Policy = DefaultRefCount, typename T>
+SharedPtr<T, Policy> ToShared(IntrusivePtr<T> ptr) {
+    if (!ptr) {
+        return SharedPtr<T, Policy>();
+    }
+    return SharedPtr<T, Policy>(ptr.Detach(), IntrusiveReleaser());
+}
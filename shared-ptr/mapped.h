@@ -0,0 +1,186 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only file mappings owned by `SharedPtr` (POSIX)
+//
+// The control block owns the mapping and unmaps it when the last owner goes;
+// every slice is an aliasing owner of the same block, so handing out parts
+// of a file never copies a byte.
+
+enum class MapAdvice {
+    kNormal,
+    kSequential,
+    kRandom,
+    // Starts reading ahead right away
+    kWillNeed,
+};
+
+struct MapOptions {
+    // Reads the whole range in before returning (`MAP_POPULATE`)
+    bool populate = false;
+    // Asks for transparent huge pages, where the file system supports them
+    bool huge_pages = false;
+    MapAdvice advice = MapAdvice::kNormal;
+};
+
+template <typename Policy = DefaultRefCount>
+struct ControlBlockMapping : ControlBlock<ControlBlockMapping<Policy>, Policy> {
+    void* base_;
+    size_t length_;
+
+    ControlBlockMapping(void* base, size_t length) noexcept : base_(base), length_(length) {
+    }
+
+    void IfNoShared() noexcept {
+        munmap(base_, length_);
+    }
+};
+
+// `size` elements under a shared owner; copies and slices share the owner
+template <typename T, typename Policy = DefaultRefCount>
+class SharedSpan {
+private:
+    SharedPtr<const T[], Policy> data_;
+    size_t size_ = 0;
+
+public:
+    static constexpr size_t kToEnd = SIZE_MAX;
+
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    SharedSpan() noexcept = default;
+    SharedSpan(SharedPtr<const T[], Policy> data, size_t size) noexcept
+        : data_(std::move(data)), size_(size) {
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    const T* Get() const noexcept {
+        return data_.Get();
+    }
+    size_t Size() const noexcept {
+        return size_;
+    }
+    const T& operator[](size_t i) const noexcept {
+        return data_.Get()[i];
+    }
+    // The owner itself, to keep or to alias further
+    const SharedPtr<const T[], Policy>& Owner() const noexcept {
+        return data_;
+    }
+    explicit operator bool() const noexcept {
+        return static_cast<bool>(data_);
+    }
+
+    // Slices
+    ///////////////////////////////////////////////////////////////////////
+
+    SharedSpan Subspan(size_t offset, size_t count = kToEnd) const {
+        if (offset > size_) {
+            throw std::out_of_range("SharedSpan: offset past the end");
+        }
+        if (count == kToEnd) {
+            count = size_ - offset;
+        } else if (count > size_ - offset) {
+            throw std::out_of_range("SharedSpan: count past the end");
+        }
+        return SharedSpan(SharedPtr<const T[], Policy>(data_, data_.Get() + offset), count);
+    }
+    // The same bytes as whole `U`-s; they must be suitably aligned
+    template <typename U>
+    SharedSpan<U, Policy> As() const {
+        static_assert(std::is_trivially_copyable_v<U>, "Mapped bytes can only be viewed as PODs");
+        if (reinterpret_cast<uintptr_t>(data_.Get()) % alignof(U) != 0) {
+            throw std::invalid_argument("SharedSpan: misaligned view");
+        }
+        return SharedSpan<U, Policy>(
+            SharedPtr<const U[], Policy>(data_, reinterpret_cast<const U*>(data_.Get())),
+            size_ * sizeof(T) / sizeof(U));
+    }
+};
+
+// Maps `length` bytes of `path` from `offset`, by default to the end of the
+// file; an empty range gives an empty span. Throws `std::system_error` if
+// the file can't be opened or mapped.
+template <typename Policy = DefaultRefCount>
+SharedSpan<std::byte, Policy> MapFile(const std::string& path, size_t offset = 0,
+                                      size_t length = SIZE_MAX, const MapOptions& options = {}) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "fstat " + path);
+    }
+    size_t file_size = static_cast<size_t>(status.st_size);
+    if (offset > file_size) {
+        close(fd);
+        throw std::out_of_range("MapFile: offset past the end of " + path);
+    }
+    if (length > file_size - offset) {
+        length = file_size - offset;
+    }
+    if (length == 0) {
+        close(fd);
+        return SharedSpan<std::byte, Policy>();
+    }
+
+    // `mmap` wants a page-aligned offset; the block maps from there
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t delta = offset % page;
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (options.populate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* base = mmap(nullptr, length + delta, PROT_READ, flags, fd,
+                      static_cast<off_t>(offset - delta));
+    int error = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), "mmap " + path);
+    }
+
+    // Hints only: a kernel that ignores them still gives a valid mapping
+#ifdef MADV_HUGEPAGE
+    if (options.huge_pages) {
+        madvise(base, length + delta, MADV_HUGEPAGE);
+    }
+#endif
+    static constexpr int kAdvice[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED};
+    if (options.advice != MapAdvice::kNormal) {
+        madvise(base, length + delta, kAdvice[static_cast<int>(options.advice)]);
+    }
+
+    ControlBlockMapping<Policy>* block;
+    try {
+        block = new ControlBlockMapping<Policy>(base, length + delta);
+    } catch (...) {
+        munmap(base, length + delta);
+        throw;
+    }
+    auto data = static_cast<const std::byte*>(base) + delta;
+    SharedPtr<const std::byte[], Policy> owner(kAdoptNew, data, block);
+    return SharedSpan<std::byte, Policy>(std::move(owner), length);
+}
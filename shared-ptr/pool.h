@@ -0,0 +1,270 @@
+#pragma once
+
+#include "shared.h"
+#include "../unique-ptr/unique.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+struct PoolStats {
+    size_t live_blocks = 0;
+    // Served from a free list
+    size_t hits = 0;
+    // Carved from fresh slab memory
+    size_t misses = 0;
+    // Freed by a thread other than the one owning the memory
+    size_t remote_frees = 0;
+    size_t slabs = 0;
+};
+
+// Per-thread slab pool for control blocks
+//
+// Blocks are segregated into 16-byte size classes. Each thread owns a cache
+// with a free list per class and carves new blocks from 64 KiB slabs aligned
+// to their size, so the owning cache is found by masking the block address.
+// A block freed by another thread is pushed onto the owner's lock-free stack
+// for that class, which the owner takes over as a whole once its own list
+// runs dry. Caches outlive their threads and are handed to new ones.
+class ControlBlockPool {
+public:
+    static constexpr size_t kSlabSize = 64 * 1024;
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxBlockSize = 512;
+
+    static constexpr bool Fits(size_t size, size_t align) noexcept {
+        return size <= kMaxBlockSize && align <= kGranularity;
+    }
+
+    static void* Allocate(size_t size) {
+        size_t size_class = SizeClass(size);
+        ThreadCache* cache = LocalCache();
+        if (!cache) {
+            // The thread is past its `thread_local` teardown
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> guard(registry.mutex);
+            return registry.shared_cache.Allocate(size_class, &registry.shared_cache);
+        }
+        return cache->Allocate(size_class, cache);
+    }
+
+    static void Deallocate(void* ptr, size_t size) noexcept {
+        size_t size_class = SizeClass(size);
+        auto node = static_cast<FreeNode*>(ptr);
+        auto slab = reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(ptr) &
+                                                  ~(uintptr_t{kSlabSize} - 1));
+        ThreadCache* cache = LocalCache();
+        if (slab->owner == cache) {
+            node->next = cache->free[size_class];
+            cache->free[size_class] = node;
+            Bump(cache->deallocations);
+            return;
+        }
+        slab->owner->PushRemote(size_class, node);
+        if (cache) {
+            Bump(cache->deallocations);
+            Bump(cache->remote_frees);
+        } else {
+            GetRegistry().late_deallocations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static PoolStats Stats() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        size_t allocations = 0;
+        size_t deallocations = registry.late_deallocations.load(std::memory_order_relaxed);
+        PoolStats stats;
+        auto add = [&](const ThreadCache& cache) {
+            allocations += cache.allocations.load(std::memory_order_relaxed);
+            deallocations += cache.deallocations.load(std::memory_order_relaxed);
+            stats.hits += cache.hits.load(std::memory_order_relaxed);
+            stats.misses += cache.misses.load(std::memory_order_relaxed);
+            stats.remote_frees += cache.remote_frees.load(std::memory_order_relaxed);
+            stats.slabs += cache.slabs.load(std::memory_order_relaxed);
+        };
+        add(registry.shared_cache);
+        for (const auto& cache : registry.caches) {
+            add(*cache);
+        }
+        stats.remote_frees += registry.late_deallocations.load(std::memory_order_relaxed);
+        stats.live_blocks = allocations - deallocations;
+        return stats;
+    }
+
+private:
+    static constexpr size_t kClasses = kMaxBlockSize / kGranularity;
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct ThreadCache;
+
+    struct alignas(kGranularity) SlabHeader {
+        ThreadCache* owner;
+    };
+
+    // Counters have a single writer; atomics only keep `Stats()` readers safe
+    static void Bump(std::atomic<size_t>& counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    struct ThreadCache {
+        FreeNode* free[kClasses] = {};
+        char* slab_pos = nullptr;
+        char* slab_end = nullptr;
+
+        std::atomic<size_t> allocations{0};
+        std::atomic<size_t> deallocations{0};
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<size_t> remote_frees{0};
+        std::atomic<size_t> slabs{0};
+
+        // Written by foreign threads, kept off the owner's cache lines
+        alignas(64) std::atomic<FreeNode*> remote[kClasses] = {};
+
+        // `self` is the cache recorded as the owner of freshly carved slabs
+        void* Allocate(size_t size_class, ThreadCache* self) {
+            Bump(allocations);
+            FreeNode* node = free[size_class];
+            if (!node) {
+                node = remote[size_class].exchange(nullptr, std::memory_order_acquire);
+            }
+            if (node) {
+                free[size_class] = node->next;
+                Bump(hits);
+                return node;
+            }
+            Bump(misses);
+            size_t size = (size_class + 1) * kGranularity;
+            if (static_cast<size_t>(slab_end - slab_pos) < size) {
+                auto slab = static_cast<char*>(::operator new(kSlabSize,
+                                                              std::align_val_t{kSlabSize}));
+                new (slab) SlabHeader{self};
+                slab_pos = slab + sizeof(SlabHeader);
+                slab_end = slab + kSlabSize;
+                Bump(slabs);
+            }
+            void* block = slab_pos;
+            slab_pos += size;
+            return block;
+        }
+
+        void PushRemote(size_t size_class, FreeNode* node) noexcept {
+            FreeNode* head = remote[size_class].load(std::memory_order_relaxed);
+            do {
+                node->next = head;
+            } while (!remote[size_class].compare_exchange_weak(
+                head, node, std::memory_order_release, std::memory_order_relaxed));
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadCache>> caches;
+        std::vector<ThreadCache*> orphans;
+        // Serves threads whose own cache is already gone, under `mutex`
+        ThreadCache shared_cache;
+        std::atomic<size_t> late_deallocations{0};
+    };
+
+    static Registry& GetRegistry() {
+        // Never destroyed: blocks may be released during static destruction
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    struct CacheHandle {
+        CacheHandle() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> guard(registry.mutex);
+            if (registry.orphans.empty()) {
+                registry.caches.push_back(std::make_unique<ThreadCache>());
+                local_cache = registry.caches.back().get();
+            } else {
+                local_cache = registry.orphans.back();
+                registry.orphans.pop_back();
+            }
+        }
+        ~CacheHandle() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> guard(registry.mutex);
+            registry.orphans.push_back(local_cache);
+            local_cache = nullptr;
+            torn_down = true;
+        }
+    };
+
+    static inline thread_local ThreadCache* local_cache = nullptr;
+    static inline thread_local bool torn_down = false;
+
+    static ThreadCache* LocalCache() {
+        if (!local_cache && !torn_down) {
+            thread_local CacheHandle handle;
+        }
+        return local_cache;
+    }
+
+    static constexpr size_t SizeClass(size_t size) noexcept {
+        return size == 0 ? 0 : (size - 1) / kGranularity;
+    }
+};
+
+// Standard allocator drawing on `ControlBlockPool`; requests the pool can't
+// serve (too large or over-aligned) go to `std::allocator`
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {
+    }
+
+    T* allocate(size_t n) {
+        if (FitsPool(n)) {
+            return static_cast<T*>(ControlBlockPool::Allocate(n * sizeof(T)));
+        }
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* ptr, size_t n) noexcept {
+        if (FitsPool(n)) {
+            ControlBlockPool::Deallocate(ptr, n * sizeof(T));
+        } else {
+            std::allocator<T>().deallocate(ptr, n);
+        }
+    }
+
+private:
+    static constexpr bool FitsPool(size_t n) noexcept {
+        return n <= ControlBlockPool::kMaxBlockSize / sizeof(T) &&
+               ControlBlockPool::Fits(n * sizeof(T), alignof(T));
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept {
+    return true;
+}
+template <typename T, typename U>
+inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) noexcept {
+    return false;
+}
+
+// `MakeShared` with the block taken from the pool
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+SharedPtr<T, Policy> MakeSharedPooled(Args&&... args) {
+    return AllocateShared<T, Policy>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+// `SharedPtr(ptr)` with the block taken from the pool
+template <typename T, typename Policy = DefaultRefCount>
+SharedPtr<T, Policy> SharePooled(T* ptr) {
+    return SharedPtr<T, Policy>(ptr, Slug<T>(), PoolAllocator<T>());
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Reference counting policies
+//
+// A policy supplies `RefCounts`, the counters every control block starts with.
+// Both counters begin at one: the weak counter keeps an extra reference on
+// behalf of all shared owners together, so whoever drops it to zero is the
+// only party left and may free the block.
+//
+// `IsLastReference()` lets the final owner skip the decrements altogether:
+// when it holds the only reference of any kind, no one can take a new one.
+//
+// `Counter` is a lone counter with the same synchronization, for counts that
+// live outside a control block.
+///////////////////////////////////////////////////////////////////////
+
+// Plain counters, for pointers that never leave their thread
+struct SingleThreadedRefCount {
+    class Counter {
+    private:
+        size_t count_;
+
+    public:
+        explicit Counter(size_t count = 0) noexcept : count_(count) {
+        }
+
+        void Increment() noexcept {
+            ++count_;
+        }
+        // Returns `true` if the count dropped to zero
+        bool Decrement() noexcept {
+            return --count_ == 0;
+        }
+        size_t Get() const noexcept {
+            return count_;
+        }
+    };
+
+    class RefCounts {
+    private:
+        size_t shared_refs_ = 1;
+        size_t weak_refs_ = 1;
+
+    public:
+        void IncrementShared() noexcept {
+            ++shared_refs_;
+        }
+        bool TryIncrementShared() noexcept {
+            if (shared_refs_ == 0) {
+                return false;
+            }
+            ++shared_refs_;
+            return true;
+        }
+        // Returns `true` if the last shared reference was dropped
+        bool DecrementShared() noexcept {
+            return --shared_refs_ == 0;
+        }
+
+        void IncrementWeak() noexcept {
+            ++weak_refs_;
+        }
+        // Returns `true` if the block is not referenced anymore
+        bool DecrementWeak() noexcept {
+            return --weak_refs_ == 0;
+        }
+
+        bool IsLastReference() const noexcept {
+            return shared_refs_ == 1 && weak_refs_ == 1;
+        }
+        size_t SharedCount() const noexcept {
+            return shared_refs_;
+        }
+    };
+};
+
+// Atomic counters, safe to share between threads
+//
+// Increments are relaxed: a new reference is always made from an existing
+// one, which already keeps the block alive. Decrements are acquire-release:
+// every owner's writes must be visible to whoever reaches zero and destroys.
+struct AtomicRefCount {
+    class Counter {
+    private:
+        std::atomic<size_t> count_;
+
+    public:
+        explicit Counter(size_t count = 0) noexcept : count_(count) {
+        }
+
+        void Increment() noexcept {
+            count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        bool Decrement() noexcept {
+            return count_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+        size_t Get() const noexcept {
+            return count_.load(std::memory_order_acquire);
+        }
+    };
+
+    class RefCounts {
+    private:
+        std::atomic<size_t> shared_refs_{1};
+        std::atomic<size_t> weak_refs_{1};
+
+    public:
+        void IncrementShared() noexcept {
+            shared_refs_.fetch_add(1, std::memory_order_relaxed);
+        }
+        bool TryIncrementShared() noexcept {
+            size_t count = shared_refs_.load(std::memory_order_relaxed);
+            do {
+                if (count == 0) {
+                    return false;
+                }
+            } while (!shared_refs_.compare_exchange_weak(count, count + 1,
+                                                         std::memory_order_acq_rel,
+                                                         std::memory_order_relaxed));
+            return true;
+        }
+        bool DecrementShared() noexcept {
+            return shared_refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        void IncrementWeak() noexcept {
+            weak_refs_.fetch_add(1, std::memory_order_relaxed);
+        }
+        bool DecrementWeak() noexcept {
+            return weak_refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+
+        // The two counters can't be read at once, so there is no shortcut
+        bool IsLastReference() const noexcept {
+            return false;
+        }
+        size_t SharedCount() const noexcept {
+            return shared_refs_.load(std::memory_order_acquire);
+        }
+    };
+};
+
+// Atomic counters packed into one 64-bit word: shared in the low half, weak
+// in the high half
+//
+// A single load tells whether the releasing owner is alone, so the last
+// release of an object nobody observes through `WeakPtr` costs no atomic
+// read-modify-write at all.
+struct PackedAtomicRefCount {
+    using Counter = AtomicRefCount::Counter;
+
+    class RefCounts {
+    private:
+        static constexpr uint64_t kOneShared = 1;
+        static constexpr uint64_t kOneWeak = uint64_t{1} << 32;
+        static constexpr uint64_t kSharedMask = kOneWeak - 1;
+
+        std::atomic<uint64_t> refs_{kOneShared + kOneWeak};
+
+    public:
+        void IncrementShared() noexcept {
+            refs_.fetch_add(kOneShared, std::memory_order_relaxed);
+        }
+        bool TryIncrementShared() noexcept {
+            uint64_t refs = refs_.load(std::memory_order_relaxed);
+            do {
+                if ((refs & kSharedMask) == 0) {
+                    return false;
+                }
+            } while (!refs_.compare_exchange_weak(refs, refs + kOneShared,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed));
+            return true;
+        }
+        bool DecrementShared() noexcept {
+            return (refs_.fetch_sub(kOneShared, std::memory_order_acq_rel) & kSharedMask) == 1;
+        }
+
+        void IncrementWeak() noexcept {
+            refs_.fetch_add(kOneWeak, std::memory_order_relaxed);
+        }
+        bool DecrementWeak() noexcept {
+            return (refs_.fetch_sub(kOneWeak, std::memory_order_acq_rel) >> 32) == 1;
+        }
+
+        bool IsLastReference() const noexcept {
+            return refs_.load(std::memory_order_acquire) == kOneShared + kOneWeak;
+        }
+        size_t SharedCount() const noexcept {
+            return refs_.load(std::memory_order_acquire) & kSharedMask;
+        }
+    };
+};
+
+using DefaultRefCount = AtomicRefCount;
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+// Batch release of many `SharedPtr`-s, e.g. when tearing down a container
+//
+// Pointers are handled a batch at a time: all control blocks of the batch
+// are prefetched before any is touched, then decremented, and only then are
+// the objects that died destroyed. The counter updates don't wait on each
+// other's cache misses, and destructors don't evict blocks still to be
+// decremented.
+//
+// Only the prefetches and decrements are batched. Each dead block is still
+// destroyed and freed on its own, by its own control block operations, as
+// the blocks may come from different allocators.
+struct BatchRelease {
+    static constexpr size_t kBatch = 32;
+
+    template <typename Iterator>
+    static void Release(Iterator first, Iterator last) noexcept {
+        using Pointer = typename std::iterator_traits<Iterator>::value_type;
+        using Block = std::remove_pointer_t<decltype(Pointer().block_)>;
+
+        Block* blocks[kBatch];
+        const void* objects[kBatch];
+        while (first != last) {
+            size_t count = 0;
+            for (; first != last && count < kBatch; ++first) {
+                Pointer& pointer = *first;
+                if (pointer.block_) {
+                    Prefetch(pointer.block_);
+                    blocks[count] = pointer.block_;
+                    objects[count] = pointer.ptr_;
+                    ++count;
+                }
+                pointer.ptr_ = nullptr;
+                pointer.block_ = nullptr;
+            }
+
+            // Dead blocks are compacted to the front, keeping `IsLastReference`
+            // ones apart: their weak reference doesn't need an RMW
+            size_t dead = 0;
+            bool disposed[kBatch];
+            for (size_t i = 0; i < count; ++i) {
+                Block* block = blocks[i];
+                bool last_reference = block->IsLastReference();
+                if (last_reference || block->DecrementShared()) {
+                    Prefetch(objects[i]);
+                    blocks[dead] = block;
+                    disposed[dead] = last_reference;
+                    ++dead;
+                }
+            }
+            for (size_t i = 0; i < dead; ++i) {
+                if (disposed[i]) {
+                    blocks[i]->Dispose();
+                } else {
+                    blocks[i]->IfNoShared();
+                    blocks[i]->ReleaseWeak();
+                }
+            }
+        }
+    }
+
+private:
+    static void Prefetch(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address, 1);
+#else
+        (void)address;
+#endif
+    }
+};
+
+// Leaves every pointer in `[first, last)` empty
+template <typename Iterator>
+void ReleaseAll(Iterator first, Iterator last) noexcept {
+    BatchRelease::Release(first, last);
+}
+
+template <typename T, typename Policy>
+void ReleaseAll(SharedPtr<T, Policy>* pointers, size_t count) noexcept {
+    BatchRelease::Release(pointers, pointers + count);
+}
+
+// Also empties the vector
+template <typename T, typename Policy, typename Alloc>
+void ReleaseAll(std::vector<SharedPtr<T, Policy>, Alloc>& pointers) noexcept {
+    BatchRelease::Release(pointers.begin(), pointers.end());
+    pointers.clear();
+}
@@ -1,66 +1,407 @@
 #pragma once
 
 #include "sw_fwd.h" 
+#include "../unique-ptr/compressed_pair.h"
+#include "../unique-ptr/instrument.h"
+#include "../unique-ptr/unique.h"
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+template <typename Policy>
+struct ControlBlockBase;
+
+// Per-type operations of a control block, shared by all its instances
+template <typename Policy>
+struct ControlBlockOps {
+    // Destroys the managed object
+    void (*if_no_shared)(ControlBlockBase<Policy>*) noexcept;
+    // Destroys and frees the block itself
+    void (*deallocate)(ControlBlockBase<Policy>*) noexcept;
+    // Both of the above, for a block released by its only user
+    void (*dispose)(ControlBlockBase<Policy>*) noexcept;
+};
+
+// The block carries a pointer to a static `ControlBlockOps` table instead of
+// a vtable: no virtual destructor, and the final release of an unobserved
+// block is a single indirect call
+template <typename Policy = DefaultRefCount>
+struct ControlBlockBase : Policy::RefCounts, PtrInstrumentation::BlockTag {
+    const ControlBlockOps<Policy>* ops_;
 
-struct ControlBlockBase {
-    int shared_refs = 0, weak_refs = 0;
+    explicit ControlBlockBase(const ControlBlockOps<Policy>* ops) noexcept : ops_(ops) {
+        PtrInstrumentation::BlockCreated();
+    }
+#if SMART_PTRS_INSTRUMENT
+    // Also runs for a block whose constructor threw
+    ~ControlBlockBase() {
+        PtrInstrumentation::BlockFreed();
+    }
+#endif
 
-    virtual ~ControlBlockBase() = default;
-    virtual void IfNoShared() = 0;
+    void IfNoShared() noexcept {
+        this->RecordRelease();
+        ops_->if_no_shared(this);
+    }
+    // Frees the block itself, through the allocator it came from
+    void Deallocate() noexcept {
+        ops_->deallocate(this);
+    }
+    // Both, for a block released by its only user
+    void Dispose() noexcept {
+        this->RecordRelease();
+        ops_->dispose(this);
+    }
+
+    // Drops a shared reference; the last one destroys the object and gives up
+    // the weak reference held on behalf of all shared owners
+    void ReleaseShared() noexcept {
+        if (this->IsLastReference()) {
+            Dispose();
+            return;
+        }
+        if (this->DecrementShared()) {
+            IfNoShared();
+            ReleaseWeak();
+        }
+    }
+    void ReleaseWeak() noexcept {
+        if (this->DecrementWeak()) {
+            Deallocate();
+        }
+    }
 };
 
-template <typename T>
-struct ControlBlockPtr : ControlBlockBase {
+// Base for concrete blocks: builds the ops table of `Block`, which must
+// define `IfNoShared()` and may replace the default `Deallocate()` and
+// `IfLastReference()`
+template <typename Block, typename Policy>
+struct ControlBlock : ControlBlockBase<Policy> {
+    ControlBlock() noexcept : ControlBlockBase<Policy>(&kOps) {
+    }
+
+    void Deallocate() noexcept {
+        delete static_cast<Block*>(this);
+    }
+    // Released by its only user: nothing else can keep the block alive
+    void IfLastReference() noexcept {
+        auto concrete = static_cast<Block*>(this);
+        concrete->IfNoShared();
+        concrete->Deallocate();
+    }
+
+private:
+    static void IfNoSharedOp(ControlBlockBase<Policy>* block) noexcept {
+        static_cast<Block*>(block)->IfNoShared();
+    }
+    static void DeallocateOp(ControlBlockBase<Policy>* block) noexcept {
+        static_cast<Block*>(block)->Deallocate();
+    }
+    static void DisposeOp(ControlBlockBase<Policy>* block) noexcept {
+        static_cast<Block*>(block)->IfLastReference();
+    }
+
+    static constexpr ControlBlockOps<Policy> kOps{&IfNoSharedOp, &DeallocateOp, &DisposeOp};
+};
+
+template <typename T, typename Policy = DefaultRefCount>
+struct ControlBlockPtr : ControlBlock<ControlBlockPtr<T, Policy>, Policy> {
     T* ptr_;
 
     ControlBlockPtr(T* ptr) : ptr_(ptr) {
     }
 
-    void IfNoShared() override {
+    void IfNoShared() noexcept {
         delete ptr_;
         ptr_ = nullptr;
     }
-
-    ~ControlBlockPtr() override = default;
 };
 
-template <typename T>
-struct ControlBlockHolder : ControlBlockBase {
+template <typename T, typename Policy = DefaultRefCount>
+struct ControlBlockHolder : ControlBlock<ControlBlockHolder<T, Policy>, Policy> {
     std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
 
     template <typename... Args>
     ControlBlockHolder(Args&&... args) {
         new (&storage_) T{std::forward<Args>(args)...};
     }
+    explicit ControlBlockHolder(DefaultInitTag) {
+        new (&storage_) T;
+    }
 
-    void IfNoShared() override {
+    void IfNoShared() noexcept {
         reinterpret_cast<T*>(&storage_)->~T();
     }
 
-    ~ControlBlockHolder() override = default;
+    T* Get() {
+        return reinterpret_cast<T*>(&storage_);
+    }
+};
+
+// Rather than `std::hardware_destructive_interference_size`, which may
+// change with tuning flags and so differ between translation units
+inline constexpr size_t kCacheLineSize = 64;
+
+// Holder with the object on cache lines of its own, away from the counters:
+// counting owners don't invalidate the lines other cores read the object from
+template <typename T, typename Policy = DefaultRefCount>
+struct alignas(kCacheLineSize) ControlBlockAlignedHolder
+    : ControlBlock<ControlBlockAlignedHolder<T, Policy>, Policy> {
+    alignas(kCacheLineSize) std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+
+    template <typename... Args>
+    ControlBlockAlignedHolder(Args&&... args) {
+        new (&storage_) T{std::forward<Args>(args)...};
+    }
+
+    void IfNoShared() noexcept {
+        reinterpret_cast<T*>(&storage_)->~T();
+    }
 
     T* Get() {
         return reinterpret_cast<T*>(&storage_);
     }
 };
 
-template <typename T>
-class SharedPtr {
+// Allocates and constructs a control block through `alloc` rebound to it
+template <typename Block, typename Alloc, typename... Args>
+Block* AllocateBlock(const Alloc& alloc, Args&&... args) {
+    using BlockAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+    BlockAlloc block_alloc(alloc);
+    Block* block = std::allocator_traits<BlockAlloc>::allocate(block_alloc, 1);
+    try {
+        return new (block) Block(std::forward<Args>(args)...);
+    } catch (...) {
+        std::allocator_traits<BlockAlloc>::deallocate(block_alloc, block, 1);
+        throw;
+    }
+}
+
+// Destroys a block made by `AllocateBlock` and returns its memory to `alloc`
+template <typename Block, typename BlockAlloc>
+void DeallocateBlock(Block* block, BlockAlloc& alloc) noexcept {
+    BlockAlloc block_alloc(std::move(alloc));
+    block->~Block();
+    std::allocator_traits<BlockAlloc>::deallocate(block_alloc, block, 1);
+}
+
+// Empty deleters and allocators take no space in the block
+template <typename T, typename Deleter, typename Alloc, typename Policy = DefaultRefCount>
+struct ControlBlockDeleter : ControlBlock<ControlBlockDeleter<T, Deleter, Alloc, Policy>, Policy> {
+    using BlockAlloc =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<ControlBlockDeleter>;
+
+    CompressedTuple<T*, Deleter, BlockAlloc> data_;
+
+    ControlBlockDeleter(T* ptr, Deleter deleter, const Alloc& alloc)
+        : data_(ptr, std::move(deleter), BlockAlloc(alloc)) {
+    }
+
+    void IfNoShared() noexcept {
+        data_.template Get<1>()(data_.template Get<0>());
+        data_.template Get<0>() = nullptr;
+    }
+
+    void Deallocate() noexcept {
+        DeallocateBlock(this, data_.template Get<2>());
+    }
+};
+
+template <typename T, typename Alloc, typename Policy = DefaultRefCount>
+struct ControlBlockAllocHolder : ControlBlock<ControlBlockAllocHolder<T, Alloc, Policy>, Policy> {
+    using BlockAlloc =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<ControlBlockAllocHolder>;
+
+    // An empty allocator shares its bytes with the object
+    CompressedTuple<std::aligned_storage_t<sizeof(T), alignof(T)>, BlockAlloc> data_;
+
+    // Only the allocator is constructed: the storage is left for the object
+    template <typename... Args>
+    ControlBlockAllocHolder(const Alloc& alloc, Args&&... args)
+        : data_(DefaultInitTag{}, BlockAlloc(alloc)) {
+        new (Get()) T{std::forward<Args>(args)...};
+    }
+
+    void IfNoShared() noexcept {
+        Get()->~T();
+    }
+
+    void Deallocate() noexcept {
+        DeallocateBlock(this, data_.template Get<1>());
+    }
+
+    T* Get() {
+        return reinterpret_cast<T*>(&data_.template Get<0>());
+    }
+};
+
+// Control block followed by `count_` elements in the same allocation
+template <typename T, typename Policy = DefaultRefCount>
+struct ControlBlockArray : ControlBlock<ControlBlockArray<T, Policy>, Policy> {
+    static_assert(!std::is_array_v<T>, "Multidimensional arrays are not supported");
+
+    size_t count_;
+
+    explicit ControlBlockArray(size_t count) noexcept : count_(count) {
+    }
+
+    // Elements are value-initialized, or default-initialized (left
+    // indeterminate for trivial types) if `value_init` is `false`
+    static ControlBlockArray* Create(size_t count, bool value_init) {
+        if (count > (SIZE_MAX - ElementsOffset()) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void* memory = AllocateMemory(ElementsOffset() + count * sizeof(T));
+        auto block = new (memory) ControlBlockArray(count);
+        T* elements = block->Get();
+        size_t constructed = 0;
+        try {
+            if (value_init) {
+                for (; constructed < count; ++constructed) {
+                    new (elements + constructed) T();
+                }
+            } else {
+                for (; constructed < count; ++constructed) {
+                    new (elements + constructed) T;
+                }
+            }
+        } catch (...) {
+            block->count_ = constructed;
+            block->IfNoShared();
+            block->~ControlBlockArray();
+            DeallocateMemory(memory);
+            throw;
+        }
+        return block;
+    }
+    // A single element made from `args`, as for `MakeUniquePromotable`
+    template <typename... Args>
+    static ControlBlockArray* CreateOne(Args&&... args) {
+        void* memory = AllocateMemory(ElementsOffset() + sizeof(T));
+        auto block = new (memory) ControlBlockArray(1);
+        try {
+            new (block->Get()) T{std::forward<Args>(args)...};
+        } catch (...) {
+            block->~ControlBlockArray();
+            DeallocateMemory(memory);
+            throw;
+        }
+        return block;
+    }
+    static ControlBlockArray* FromElements(T* elements) noexcept {
+        return reinterpret_cast<ControlBlockArray*>(reinterpret_cast<char*>(elements) -
+                                                    ElementsOffset());
+    }
+
+    void IfNoShared() noexcept {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            T* elements = Get();
+            for (size_t i = count_; i > 0; --i) {
+                elements[i - 1].~T();
+            }
+        }
+    }
+
+    void Deallocate() noexcept {
+        this->~ControlBlockArray();
+        DeallocateMemory(this);
+    }
+
+    T* Get() noexcept {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + ElementsOffset());
+    }
+
 private:
-    T* ptr_;
-    ControlBlockBase* block_;
+    static constexpr size_t kAlignment =
+        alignof(T) > alignof(ControlBlock<ControlBlockArray, Policy>)
+            ? alignof(T)
+            : alignof(ControlBlock<ControlBlockArray, Policy>);
+    static constexpr bool kOverAligned = kAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    static constexpr size_t ElementsOffset() noexcept {
+        return (sizeof(ControlBlockArray) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
 
-    template <typename Y, typename... Args>
-    friend SharedPtr<Y> MakeShared(Args&&... args);
+    static void* AllocateMemory(size_t size) {
+        if constexpr (kOverAligned) {
+            return ::operator new(size, std::align_val_t{kAlignment});
+        } else {
+            return ::operator new(size);
+        }
+    }
+    static void DeallocateMemory(void* memory) noexcept {
+        if constexpr (kOverAligned) {
+            ::operator delete(memory, std::align_val_t{kAlignment});
+        } else {
+            ::operator delete(memory);
+        }
+    }
+};
 
-    template <typename Y>
+// Deleter of objects made by `MakeUniquePromotable`: they sit in a control
+// block of their own, ready for `SharedPtr` to adopt without allocating
+template <typename T, typename Policy = DefaultRefCount>
+struct PromotableDelete {
+    void operator()(T* ptr) const noexcept {
+        ControlBlockArray<T, Policy>::FromElements(ptr)->Dispose();
+    }
+};
+
+// Tag for taking over the shared reference a fresh control block starts with
+struct AdoptRefTag {};
+inline constexpr AdoptRefTag kAdoptRef{};
+
+// The same for the block of a brand new object, additionally connecting the
+// object's `EnableSharedFromThis` base, if any, to the block
+struct AdoptNewTag {};
+inline constexpr AdoptNewTag kAdoptNew{};
+
+// A raw `Y*` may be owned as `SharedPtr<T>`: for arrays, as a pointer to an
+// array of `Y`, so elements of another size don't pass for `T`-s
+template <typename Y, typename T>
+struct IsOwnableAs : std::is_convertible<Y*, T*> {};
+template <typename Y, typename U>
+struct IsOwnableAs<Y, U[]> : std::is_convertible<Y (*)[], U (*)[]> {};
+template <typename Y, typename U, size_t N>
+struct IsOwnableAs<Y, U[N]> : std::is_convertible<Y (*)[N], U (*)[N]> {};
+
+// `SharedPtr<Y>` may convert to `SharedPtr<T>`; `Y[N]` goes to `T[]` as well
+template <typename Y, typename T>
+inline constexpr bool kIsCompatiblePtr =
+    std::is_convertible_v<Y*, T*> ||
+    (std::extent_v<Y> != 0 && std::is_array_v<T> && std::extent_v<T> == 0 &&
+     std::is_convertible_v<std::remove_extent_t<Y> (*)[], T*>);
+
+// `T` may be an array type, `T[]` or `T[N]`, which is then `delete[]`-d
+template <typename T, typename Policy>
+class SharedPtr {
+public:
+    using ElementType = std::remove_extent_t<T>;
+
+private:
+    ElementType* ptr_;
+    ControlBlockBase<Policy>* block_;
+
+    template <typename Y, typename P>
     friend class SharedPtr;
 
-    template <typename Y>
+    template <typename Y, typename P>
     friend class WeakPtr;
 
+    template <typename Y, typename P>
+    friend class AtomicSharedPtr;
+
+    template <typename Y, typename P>
+    friend class SharedRef;
+
+    template <typename Y, size_t B, typename P>
+    friend class TaggedSharedPtr;
+
+    friend struct BatchRelease;
+
 public:
     // Constructors
     ///////////////////////////////////////////////////////////////////////
@@ -69,88 +410,169 @@ public:
     }
     SharedPtr(std::nullptr_t) noexcept : ptr_(nullptr), block_(nullptr) {
     }
-    template <typename Y>
-    explicit SharedPtr(Y* ptr) : ptr_(ptr), block_(new ControlBlockPtr<Y>(ptr)) {
-        block_->shared_refs = 1;
+    template <typename Y, typename = std::enable_if_t<IsOwnableAs<Y, T>::value>>
+    explicit SharedPtr(Y* ptr) : ptr_(ptr), block_(NewPtrBlock(ptr)) {
+        HookSharedFromThis(ptr, ptr, block_);
+        RecordMake();
+    }
+    // `deleter` disposes of `ptr`, also if allocating the block fails
+    template <typename Y, typename Deleter,
+              typename = std::enable_if_t<IsOwnableAs<Y, T>::value>>
+    SharedPtr(Y* ptr, Deleter deleter) : SharedPtr(ptr, std::move(deleter), std::allocator<Y>()) {
+    }
+    // The same, with the block allocated through `alloc`
+    template <typename Y, typename Deleter, typename Alloc,
+              typename = std::enable_if_t<IsOwnableAs<Y, T>::value>>
+    SharedPtr(Y* ptr, Deleter deleter, Alloc alloc) : ptr_(ptr), block_(nullptr) {
+        try {
+            block_ = AllocateBlock<ControlBlockDeleter<Y, Deleter, Alloc, Policy>>(alloc, ptr,
+                                                                                  deleter, alloc);
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+        HookSharedFromThis(ptr, ptr, block_);
+        RecordMake();
     }
     template <typename Y>
-    explicit SharedPtr(Y* ptr, ControlBlockBase* block) : ptr_(ptr), block_(block) {
+    explicit SharedPtr(Y* ptr, ControlBlockBase<Policy>* block) : ptr_(ptr), block_(block) {
         if (block_) {
-            ++(block_->shared_refs);
+            block_->IncrementShared();
+            Record(PtrInstrumentation::kCopy);
         }
     }
+    // Takes over a shared reference already counted in `block`
+    template <typename Y>
+    SharedPtr(AdoptRefTag, Y* ptr, ControlBlockBase<Policy>* block) noexcept
+        : ptr_(ptr), block_(block) {
+        RecordMake();
+    }
+    template <typename Y>
+    SharedPtr(AdoptNewTag, Y* ptr, ControlBlockBase<Policy>* block) noexcept
+        : ptr_(ptr), block_(block) {
+        HookSharedFromThis(ptr, ptr, block_);
+        RecordMake();
+    }
     SharedPtr(const SharedPtr& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
         if (block_) {
-            ++(block_->shared_refs);
+            block_->IncrementShared();
+            Record(PtrInstrumentation::kCopy);
         }
     }
-    template <typename Y>
-    SharedPtr(const SharedPtr<Y>& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr(const SharedPtr<Y, Policy>& other) noexcept
+        : ptr_(other.ptr_), block_(other.block_) {
         if (block_) {
-            ++(block_->shared_refs);
+            block_->IncrementShared();
+            Record(PtrInstrumentation::kCopy);
         }
     }
     SharedPtr(SharedPtr&& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
         other.ptr_ = nullptr;
         other.block_ = nullptr;
+        Record(PtrInstrumentation::kMove);
     }
-    template <typename Y>
-    SharedPtr(SharedPtr<Y>&& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr(SharedPtr<Y, Policy>&& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
         other.ptr_ = nullptr;
         other.block_ = nullptr;
+        Record(PtrInstrumentation::kMove);
     }
 
     template <typename Y>
-    SharedPtr(const SharedPtr<Y>& other, T* ptr) noexcept : ptr_(ptr), block_(other.block_) {
+    SharedPtr(const SharedPtr<Y, Policy>& other, ElementType* ptr) noexcept
+        : ptr_(ptr), block_(other.block_) {
         if (block_) {
-            ++(block_->shared_refs);
+            block_->IncrementShared();
+            Record(PtrInstrumentation::kCopy);
+        }
+    }
+    // Takes over `other`'s reference instead of adding one
+    template <typename Y>
+    SharedPtr(SharedPtr<Y, Policy>&& other, ElementType* ptr) noexcept
+        : ptr_(ptr), block_(other.block_) {
+        other.ptr_ = nullptr;
+        other.block_ = nullptr;
+        Record(PtrInstrumentation::kMove);
+    }
+
+    // Take over a `UniquePtr`
+    ///////////////////////////////////////////////////////////////////////
+
+    // The deleter moves into a new control block; `other` keeps the object
+    // if allocating the block fails
+    template <typename Y, typename Deleter,
+              typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr(UniquePtr<Y, Deleter>&& other) : ptr_(other.Get()), block_(nullptr) {
+        using Pointee = std::remove_pointer_t<decltype(other.Get())>;
+        using Alloc = std::allocator<Pointee>;
+        if (!ptr_) {
+            return;
+        }
+        block_ = AllocateBlock<ControlBlockDeleter<Pointee, Deleter, Alloc, Policy>>(
+            Alloc(), other.Get(), std::move(other.GetDeleter()), Alloc());
+        Pointee* ptr = other.Release();
+        HookSharedFromThis(ptr, ptr, block_);
+        RecordMake();
+    }
+    // No allocation: the block is already around the object
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr(UniquePtr<Y, PromotableDelete<Y, Policy>>&& other) noexcept
+        : ptr_(other.Get()), block_(nullptr) {
+        if (Y* ptr = other.Release()) {
+            block_ = ControlBlockArray<Y, Policy>::FromElements(ptr);
+            HookSharedFromThis(ptr, ptr, block_);
+            RecordMake();
         }
     }
 
     // Promote `WeakPtr`
     ///////////////////////////////////////////////////////////////////////
  
-    explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.Expired()) {
-            throw BadWeakPtr{};
-        }
-        ptr_ = other.ptr_;
-        block_ = other.block_;
-        if (block_) {
-            ++(block_->shared_refs);
+    // Empty if `other` has expired; a single increment-if-nonzero otherwise
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr(const WeakPtr<Y, Policy>& other, std::nothrow_t) noexcept
+        : ptr_(nullptr), block_(nullptr) {
+        Record(PtrInstrumentation::kLock);
+        if (other.block_ && other.block_->TryIncrementShared()) {
+            ptr_ = other.ptr_;
+            block_ = other.block_;
+        } else {
+            Record(PtrInstrumentation::kFailedLock);
         }
     }
-    template <typename Y>
-    explicit SharedPtr(const WeakPtr<Y>& other) {
-        if (other.Expired()) {
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    explicit SharedPtr(const WeakPtr<Y, Policy>& other) : SharedPtr(other, std::nothrow) {
+        if (!block_) {
             throw BadWeakPtr{};
         }
-        ptr_ = other.ptr_;
-        block_ = other.block_;
-        if (block_) {
-            ++(block_->shared_refs);
-        }
     }
 
     // `operator=`-s
     ///////////////////////////////////////////////////////////////////////
 
     SharedPtr& operator=(const SharedPtr& other) noexcept {
-        SharedPtr<T>(other).Swap(*this);
+        SharedPtr<T, Policy>(other).Swap(*this);
         return *this;
     }
-    template <typename Y>
-    SharedPtr& operator=(const SharedPtr<Y>& other) noexcept {
-        SharedPtr<T>(other).Swap(*this);
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr& operator=(const SharedPtr<Y, Policy>& other) noexcept {
+        SharedPtr<T, Policy>(other).Swap(*this);
         return *this;
     }
     SharedPtr& operator=(SharedPtr&& other) noexcept {
-        SharedPtr<T>(std::move(other)).Swap(*this);
+        SharedPtr<T, Policy>(std::move(other)).Swap(*this);
         return *this;
     }
-    template <typename Y>
-    SharedPtr& operator=(SharedPtr<Y>&& other) noexcept {
-        SharedPtr<T>(std::move(other)).Swap(*this);
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr& operator=(SharedPtr<Y, Policy>&& other) noexcept {
+        SharedPtr<T, Policy>(std::move(other)).Swap(*this);
+        return *this;
+    }
+    template <typename Y, typename Deleter,
+              typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedPtr& operator=(UniquePtr<Y, Deleter>&& other) {
+        SharedPtr<T, Policy>(std::move(other)).Swap(*this);
         return *this;
     }
 
@@ -159,13 +581,7 @@ public:
 
     ~SharedPtr() {
         if (block_) {
-            --block_->shared_refs;
-            if (block_->shared_refs == 0) {
-                block_->IfNoShared();
-            }
-            if (block_->shared_refs + block_->weak_refs == 0) {
-                delete block_;
-            }
+            block_->ReleaseShared();
         }
     }
 
@@ -175,9 +591,9 @@ public:
     void Reset() noexcept {
         SharedPtr().Swap(*this);
     }
-    template <typename Y>
+    template <typename Y, typename = std::enable_if_t<IsOwnableAs<Y, T>::value>>
     void Reset(Y* ptr) {
-        SharedPtr<T>(ptr).Swap(*this);
+        SharedPtr<T, Policy>(ptr).Swap(*this);
     }
     void Swap(SharedPtr& other) noexcept {
         std::swap(ptr_, other.ptr_);
@@ -187,44 +603,204 @@ public:
     // Observers
     ///////////////////////////////////////////////////////////////////////
 
-    T* Get() const noexcept {
+    ElementType* Get() const noexcept {
         return ptr_;
     }
-    T& operator*() const noexcept {
+    std::add_lvalue_reference_t<ElementType> operator*() const noexcept {
         return *ptr_;
     }
-    T* operator->() const noexcept {
+    ElementType* operator->() const noexcept {
         return ptr_;
     }
+    // For array `T` only
+    std::add_lvalue_reference_t<ElementType> operator[](std::ptrdiff_t i) const noexcept {
+        return ptr_[i];
+    }
     size_t UseCount() const noexcept {
         if (block_) {
-            return block_->shared_refs;
+            return block_->SharedCount();
         }
         return 0;
     }
     explicit operator bool() const noexcept {
         return ptr_ != nullptr;
     }
+
+private:
+    static void Record(PtrInstrumentation::Event event) noexcept {
+        PtrInstrumentation::Record<ElementType>(event);
+    }
+    void RecordMake() noexcept {
+        if (block_) {
+            block_->template RecordMake<ElementType>();
+        }
+    }
+
+    // Sets the embedded weak reference unless the object is owned already
+    template <typename X, typename Y>
+    static void HookSharedFromThis(const EnableSharedFromThis<X, Policy>* base, Y* ptr,
+                                   ControlBlockBase<Policy>* block) noexcept {
+        if constexpr (!std::is_array_v<T>) {
+            if (base && base->weak_this_.Expired()) {
+                WeakPtr<X, Policy> weak_this;
+                weak_this.ptr_ = ptr;
+                weak_this.block_ = block;
+                block->IncrementWeak();
+                base->weak_this_ = std::move(weak_this);
+            }
+        }
+    }
+    static void HookSharedFromThis(const volatile void*, const volatile void*,
+                                   const void*) noexcept {
+    }
+
+    template <typename Y>
+    static ControlBlockBase<Policy>* NewPtrBlock(Y* ptr) {
+        if constexpr (std::is_array_v<T>) {
+            return AllocateBlock<ControlBlockDeleter<Y, Slug<Y[]>, std::allocator<Y>, Policy>>(
+                std::allocator<Y>(), ptr, Slug<Y[]>(), std::allocator<Y>());
+        } else {
+            return new ControlBlockPtr<Y, Policy>(ptr);
+        }
+    }
 };
 
-template <typename T, typename U>
-inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
+// Two pointers, neither to the `SharedPtr` itself
+template <typename T, typename Policy>
+struct IsTriviallyRelocatable<SharedPtr<T, Policy>> : std::true_type {};
+
+template <typename T, typename U, typename Policy>
+inline bool operator==(const SharedPtr<T, Policy>& left, const SharedPtr<U, Policy>& right) {
     return left.Get() == right.Get();
 }
 
-template <typename T, typename... Args>
-SharedPtr<T> MakeShared(Args&&... args) {
-    auto holder_block = new ControlBlockHolder<T>(std::forward<Args>(args)...);
-    return SharedPtr<T>(holder_block->Get(), holder_block);
+// Pointer casts
+//
+// The rvalue overloads move the reference into the result, leaving the count
+// alone; a failed `DynamicPointerCast` leaves its source as it was.
+///////////////////////////////////////////////////////////////////////////
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(const SharedPtr<U, Policy>& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    return SharedPtr<T, Policy>(other, static_cast<Element*>(other.Get()));
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> StaticPointerCast(SharedPtr<U, Policy>&& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    auto ptr = static_cast<Element*>(other.Get());
+    return SharedPtr<T, Policy>(std::move(other), ptr);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(const SharedPtr<U, Policy>& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    if (auto ptr = dynamic_cast<Element*>(other.Get())) {
+        return SharedPtr<T, Policy>(other, ptr);
+    }
+    return SharedPtr<T, Policy>();
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> DynamicPointerCast(SharedPtr<U, Policy>&& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    if (auto ptr = dynamic_cast<Element*>(other.Get())) {
+        return SharedPtr<T, Policy>(std::move(other), ptr);
+    }
+    return SharedPtr<T, Policy>();
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(const SharedPtr<U, Policy>& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    return SharedPtr<T, Policy>(other, const_cast<Element*>(other.Get()));
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ConstPointerCast(SharedPtr<U, Policy>&& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    auto ptr = const_cast<Element*>(other.Get());
+    return SharedPtr<T, Policy>(std::move(other), ptr);
+}
+
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ReinterpretPointerCast(const SharedPtr<U, Policy>& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    return SharedPtr<T, Policy>(other, reinterpret_cast<Element*>(other.Get()));
+}
+template <typename T, typename U, typename Policy>
+SharedPtr<T, Policy> ReinterpretPointerCast(SharedPtr<U, Policy>&& other) noexcept {
+    using Element = typename SharedPtr<T, Policy>::ElementType;
+    auto ptr = reinterpret_cast<Element*>(other.Get());
+    return SharedPtr<T, Policy>(std::move(other), ptr);
+}
+
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeShared(Args&&... args) {
+    auto holder_block = new ControlBlockHolder<T, Policy>(std::forward<Args>(args)...);
+    return SharedPtr<T, Policy>(kAdoptNew, holder_block->Get(), holder_block);
 }
 
 template <typename T>
-class EnableSharedFromThis {
-public:
-    SharedPtr<T> SharedFromThis();
-    SharedPtr<const T> SharedFromThis() const;
+inline constexpr bool kIsUnboundedArray = std::is_array_v<T> && std::extent_v<T> == 0;
 
-    WeakPtr<T> WeakFromThis() noexcept;
-    WeakPtr<const T> WeakFromThis() const noexcept;
-};
+template <typename T>
+inline constexpr bool kIsBoundedArray = std::is_array_v<T> && std::extent_v<T> != 0;
+
+// Control block, element count and elements all in one allocation
+template <typename T, typename Policy = DefaultRefCount>
+std::enable_if_t<kIsUnboundedArray<T>, SharedPtr<T, Policy>> MakeShared(size_t count) {
+    auto array_block = ControlBlockArray<std::remove_extent_t<T>, Policy>::Create(count, true);
+    return SharedPtr<T, Policy>(kAdoptRef, array_block->Get(), array_block);
+}
+template <typename T, typename Policy = DefaultRefCount>
+std::enable_if_t<kIsBoundedArray<T>, SharedPtr<T, Policy>> MakeShared() {
+    auto array_block =
+        ControlBlockArray<std::remove_extent_t<T>, Policy>::Create(std::extent_v<T>, true);
+    return SharedPtr<T, Policy>(kAdoptRef, array_block->Get(), array_block);
+}
+
+// As `MakeShared`, with the object and the counters on separate cache lines;
+// pays off for objects read from many cores while owners come and go, at
+// the cost of a larger block
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeSharedAligned(Args&&... args) {
+    auto holder_block = new ControlBlockAlignedHolder<T, Policy>(std::forward<Args>(args)...);
+    return SharedPtr<T, Policy>(kAdoptNew, holder_block->Get(), holder_block);
+}
+
+// As `MakeShared`, but the object or the elements are default-initialized:
+// trivial types are left unwritten for their producer to fill
+template <typename T, typename Policy = DefaultRefCount>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T, Policy>> MakeSharedForOverwrite() {
+    auto holder_block = new ControlBlockHolder<T, Policy>(DefaultInitTag{});
+    return SharedPtr<T, Policy>(kAdoptNew, holder_block->Get(), holder_block);
+}
+template <typename T, typename Policy = DefaultRefCount>
+std::enable_if_t<kIsUnboundedArray<T>, SharedPtr<T, Policy>> MakeSharedForOverwrite(
+    size_t count) {
+    auto array_block = ControlBlockArray<std::remove_extent_t<T>, Policy>::Create(count, false);
+    return SharedPtr<T, Policy>(kAdoptRef, array_block->Get(), array_block);
+}
+template <typename T, typename Policy = DefaultRefCount>
+std::enable_if_t<kIsBoundedArray<T>, SharedPtr<T, Policy>> MakeSharedForOverwrite() {
+    auto array_block =
+        ControlBlockArray<std::remove_extent_t<T>, Policy>::Create(std::extent_v<T>, false);
+    return SharedPtr<T, Policy>(kAdoptRef, array_block->Get(), array_block);
+}
+
+// A `UniquePtr` whose object already sits in a control block, so turning it
+// into a `SharedPtr` allocates nothing
+template <typename T, typename Policy = DefaultRefCount, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T, PromotableDelete<T, Policy>>>
+MakeUniquePromotable(Args&&... args) {
+    auto block = ControlBlockArray<T, Policy>::CreateOne(std::forward<Args>(args)...);
+    return UniquePtr<T, PromotableDelete<T, Policy>>(block->Get());
+}
+
+// Allocates the block, with the object inside it, through `alloc`
+template <typename T, typename Policy = DefaultRefCount, typename Alloc, typename... Args>
+SharedPtr<T, Policy> AllocateShared(const Alloc& alloc, Args&&... args) {
+    auto holder_block = AllocateBlock<ControlBlockAllocHolder<T, Alloc, Policy>>(
+        alloc, alloc, std::forward<Args>(args)...);
+    return SharedPtr<T, Policy>(kAdoptNew, holder_block->Get(), holder_block);
+}
 
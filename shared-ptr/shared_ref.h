@@ -0,0 +1,74 @@
+#pragma once
+
+#include "shared.h"
+#include "../unique-ptr/observer.h"
+
+#include <cstddef>
+#include <type_traits>
+
+// Borrowed view of a `SharedPtr`, for passing down synchronous call chains
+//
+// Making, copying and dropping one never touches the reference count; some
+// owner up the stack has to outlive it. A callee that needs to keep the
+// object `Promote()`-s it to an owner of the original control block.
+template <typename T, typename Policy>
+class SharedRef {
+public:
+    using ElementType = std::remove_extent_t<T>;
+
+private:
+    ElementType* ptr_;
+    ControlBlockBase<Policy>* block_;
+
+    template <typename Y, typename P>
+    friend class SharedRef;
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    SharedRef() noexcept : ptr_(nullptr), block_(nullptr) {
+    }
+    SharedRef(std::nullptr_t) noexcept : ptr_(nullptr), block_(nullptr) {
+    }
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedRef(const SharedPtr<Y, Policy>& owner) noexcept
+        : ptr_(owner.ptr_), block_(owner.block_) {
+    }
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    SharedRef(SharedRef<Y, Policy> other) noexcept : ptr_(other.ptr_), block_(other.block_) {
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    ElementType* Get() const noexcept {
+        return ptr_;
+    }
+    std::add_lvalue_reference_t<ElementType> operator*() const noexcept {
+        return *ptr_;
+    }
+    ElementType* operator->() const noexcept {
+        return ptr_;
+    }
+    // For array `T` only
+    std::add_lvalue_reference_t<ElementType> operator[](std::ptrdiff_t i) const noexcept {
+        return ptr_[i];
+    }
+    explicit operator bool() const noexcept {
+        return ptr_ != nullptr;
+    }
+    operator ObserverPtr<ElementType>() const noexcept {
+        return ObserverPtr<ElementType>(ptr_);
+    }
+
+    // The one operation that counts
+    SharedPtr<T, Policy> Promote() const noexcept {
+        return SharedPtr<T, Policy>(ptr_, block_);
+    }
+};
+
+template <typename T, typename U, typename Policy>
+inline bool operator==(SharedRef<T, Policy> left, SharedRef<U, Policy> right) noexcept {
+    return left.Get() == right.Get();
+}
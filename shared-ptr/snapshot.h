@@ -0,0 +1,103 @@
+#pragma once
+
+#include "hazard.h"
+#include "shared.h"
+
+#include <atomic>
+#include <utility>
+
+// Read-mostly published pointer whose readers never touch a reference count
+//
+// `Read()` borrows the current object under a hazard pointer: the reader
+// writes to its own slot only. `Publish()` swaps in a new owner and retires
+// the old one, which is released once no reader can still see it. Readers
+// that need to keep the object past their guard `Promote()` it to an owner.
+template <typename T, typename Policy = DefaultRefCount>
+class SnapshotPtr {
+private:
+    struct Holder {
+        T* object;
+        SharedPtr<T, Policy> owner;
+    };
+
+    std::atomic<Holder*> holder_;
+
+    static Holder* MakeHolder(SharedPtr<T, Policy> owner) {
+        if (!owner) {
+            return nullptr;
+        }
+        T* object = owner.Get();
+        return new Holder{object, std::move(owner)};
+    }
+    static void Retire(Holder* holder) {
+        if (holder) {
+            HazardPointers::Retire(holder);
+        }
+    }
+
+public:
+    // Borrowed reference, valid for the guard's lifetime even across a
+    // concurrent `Publish()`; not to be shared with other threads
+    class ReadGuard {
+    private:
+        HazardPointers::Guard hazard_;
+        const Holder* holder_;
+
+        friend class SnapshotPtr;
+
+        explicit ReadGuard(const std::atomic<Holder*>& source)
+            : holder_(hazard_.Protect(source)) {
+        }
+
+    public:
+        T* Get() const noexcept {
+            return holder_ ? holder_->object : nullptr;
+        }
+        T& operator*() const noexcept {
+            return *holder_->object;
+        }
+        T* operator->() const noexcept {
+            return holder_->object;
+        }
+        explicit operator bool() const noexcept {
+            return holder_ != nullptr;
+        }
+
+        // An owner sharing the publisher's control block
+        SharedPtr<T, Policy> Promote() const {
+            return holder_ ? holder_->owner : SharedPtr<T, Policy>();
+        }
+    };
+
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    SnapshotPtr() noexcept : holder_(nullptr) {
+    }
+    explicit SnapshotPtr(SharedPtr<T, Policy> owner) : holder_(MakeHolder(std::move(owner))) {
+    }
+    SnapshotPtr(const SnapshotPtr&) = delete;
+    SnapshotPtr& operator=(const SnapshotPtr&) = delete;
+
+    // Destructor
+    ///////////////////////////////////////////////////////////////////////
+
+    // Guards that are still around keep the last object alive
+    ~SnapshotPtr() {
+        Retire(holder_.load(std::memory_order_acquire));
+    }
+
+    // Operations
+    ///////////////////////////////////////////////////////////////////////
+
+    ReadGuard Read() const {
+        return ReadGuard(holder_);
+    }
+    SharedPtr<T, Policy> Load() const {
+        return Read().Promote();
+    }
+    void Publish(SharedPtr<T, Policy> owner) {
+        Holder* holder = MakeHolder(std::move(owner));
+        Retire(holder_.exchange(holder, std::memory_order_acq_rel));
+    }
+};
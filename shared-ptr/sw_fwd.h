@@ -1,12 +1,27 @@
 #pragma once
 
+#include "ref_count.h"
+
 #include <exception>
 
 class BadWeakPtr : public std::exception {};
 
-template <typename T>
+template <typename T, typename Policy = DefaultRefCount>
 class SharedPtr;
 
-template <typename T>
+template <typename T, typename Policy = DefaultRefCount>
 class WeakPtr;
 
+template <typename T, typename Policy = DefaultRefCount>
+class EnableSharedFromThis;
+
+template <typename T, typename Policy = DefaultRefCount>
+class AtomicSharedPtr;
+
+template <typename T, typename Policy = DefaultRefCount>
+class SharedRef;
+
+template <typename T, size_t Bits, typename Policy = DefaultRefCount>
+class TaggedSharedPtr;
+
+struct BatchRelease;
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "shared.h"
+#include "../unique-ptr/tagged.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// `SharedPtr` keeping a `Bits`-bit tag in its control block pointer, so the
+// object pointer may be anything, aliased members included; no bigger than a
+// `SharedPtr`
+//
+// Tag operations are atomic; the pointers are not, as with `SharedPtr`.
+template <typename T, size_t Bits, typename Policy>
+class TaggedSharedPtr {
+public:
+    using ElementType = std::remove_extent_t<T>;
+
+    static constexpr uintptr_t kTagMask = TaggedWord<Bits>::kTagMask;
+
+private:
+    static_assert((size_t{1} << Bits) <= alignof(ControlBlockBase<Policy>),
+                  "Control blocks leave fewer free bits");
+
+    using Block = ControlBlockBase<Policy>;
+
+    ElementType* ptr_;
+    TaggedWord<Bits> block_;
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    TaggedSharedPtr() noexcept : ptr_(nullptr) {
+    }
+    TaggedSharedPtr(std::nullptr_t) noexcept : ptr_(nullptr) {
+    }
+    // Takes over `owner`'s reference
+    explicit TaggedSharedPtr(SharedPtr<T, Policy> owner, uintptr_t tag = 0) noexcept
+        : ptr_(owner.ptr_), block_(TaggedWord<Bits>::Pack(owner.block_, tag)) {
+        owner.ptr_ = nullptr;
+        owner.block_ = nullptr;
+    }
+    // Takes the tag along
+    TaggedSharedPtr(const TaggedSharedPtr& other) noexcept
+        : ptr_(other.ptr_), block_(other.block_.Load()) {
+        if (Block* block = GetBlock()) {
+            block->IncrementShared();
+            PtrInstrumentation::Record<ElementType>(PtrInstrumentation::kCopy);
+        }
+    }
+    TaggedSharedPtr(TaggedSharedPtr&& other) noexcept
+        : ptr_(std::exchange(other.ptr_, nullptr)), block_(other.block_.Exchange(0)) {
+        PtrInstrumentation::Record<ElementType>(PtrInstrumentation::kMove);
+    }
+
+    // `operator=`-s
+    ///////////////////////////////////////////////////////////////////////
+
+    TaggedSharedPtr& operator=(const TaggedSharedPtr& other) noexcept {
+        TaggedSharedPtr(other).Swap(*this);
+        return *this;
+    }
+    TaggedSharedPtr& operator=(TaggedSharedPtr&& other) noexcept {
+        TaggedSharedPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    // Destructor
+    ///////////////////////////////////////////////////////////////////////
+
+    ~TaggedSharedPtr() {
+        static_assert(sizeof(TaggedSharedPtr) == sizeof(SharedPtr<T, Policy>));
+        if (Block* block = GetBlock()) {
+            block->ReleaseShared();
+        }
+    }
+
+    // Modifiers
+    ///////////////////////////////////////////////////////////////////////
+
+    // Hands the reference back; the tag stays
+    SharedPtr<T, Policy> Release() noexcept {
+        ElementType* ptr = std::exchange(ptr_, nullptr);
+        Block* block = Unpack(block_.SetPointer(static_cast<Block*>(nullptr)));
+        SharedPtr<T, Policy> owner;
+        owner.ptr_ = ptr;
+        owner.block_ = block;
+        return owner;
+    }
+    // Drops the object, keeping the tag
+    void Reset() noexcept {
+        SharedPtr<T, Policy> dropped = Release();
+    }
+    // Swaps the tags too
+    void Swap(TaggedSharedPtr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        uintptr_t word = block_.Exchange(other.block_.Load());
+        other.block_.Exchange(word);
+    }
+
+    void SetTag(uintptr_t tag) noexcept {
+        block_.SetTag(tag);
+    }
+    bool CompareExchangeTag(uintptr_t& expected, uintptr_t desired) noexcept {
+        return block_.CompareExchangeTag(expected, desired);
+    }
+    uintptr_t FetchOrTag(uintptr_t bits) noexcept {
+        return block_.FetchOrTag(bits);
+    }
+    uintptr_t FetchAndTag(uintptr_t bits) noexcept {
+        return block_.FetchAndTag(bits);
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    // A new owner without the tag
+    SharedPtr<T, Policy> Share() const noexcept {
+        return SharedPtr<T, Policy>(ptr_, GetBlock());
+    }
+    ElementType* Get() const noexcept {
+        return ptr_;
+    }
+    std::add_lvalue_reference_t<ElementType> operator*() const noexcept {
+        return *ptr_;
+    }
+    ElementType* operator->() const noexcept {
+        return ptr_;
+    }
+    uintptr_t Tag() const noexcept {
+        return block_.Tag();
+    }
+    size_t UseCount() const noexcept {
+        if (Block* block = GetBlock()) {
+            return block->SharedCount();
+        }
+        return 0;
+    }
+    explicit operator bool() const noexcept {
+        return ptr_ != nullptr;
+    }
+
+private:
+    static Block* Unpack(uintptr_t word) noexcept {
+        return reinterpret_cast<Block*>(word & ~kTagMask);
+    }
+    Block* GetBlock() const noexcept {
+        return block_.template Pointer<Block>();
+    }
+};
@@ -3,16 +3,18 @@
 #include "sw_fwd.h"
 #include "shared.h"
 
-template <typename T>
+#include <type_traits>
+
+template <typename T, typename Policy>
 class WeakPtr {
 private:
-    T* ptr_;
-    ControlBlockBase* block_;
+    std::remove_extent_t<T>* ptr_;
+    ControlBlockBase<Policy>* block_;
 
-    template <typename Y>
+    template <typename Y, typename P>
     friend class SharedPtr;
 
-    template <typename Y>
+    template <typename Y, typename P>
     friend class WeakPtr;
 
 public:
@@ -24,29 +26,32 @@ public:
 
     WeakPtr(const WeakPtr& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
         if (block_) {
-            ++block_->weak_refs;
+            block_->IncrementWeak();
+            PtrInstrumentation::Record<std::remove_extent_t<T>>(PtrInstrumentation::kWeak);
         }
     }
-    template <typename Y>
-    WeakPtr(const WeakPtr<Y>& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    WeakPtr(const WeakPtr<Y, Policy>& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
         if (block_) {
-            ++(block_->weak_refs);
+            block_->IncrementWeak();
+            PtrInstrumentation::Record<std::remove_extent_t<T>>(PtrInstrumentation::kWeak);
         }
     }
     WeakPtr(WeakPtr&& other) noexcept : ptr_(other.ptr_), block_(other.block_) {
         other.ptr_ = nullptr;
         other.block_ = nullptr;
     }
-    template <typename Y>
-    WeakPtr(WeakPtr<Y>&& other) : ptr_(other.ptr_), block_(other.block_) {
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    WeakPtr(WeakPtr<Y, Policy>&& other) : ptr_(other.ptr_), block_(other.block_) {
         other.ptr_ = nullptr;
         other.block_ = nullptr;
     }
 
-    template <typename Y>
-    WeakPtr(const SharedPtr<Y>& other) : ptr_(other.ptr_), block_(other.block_) {
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    WeakPtr(const SharedPtr<Y, Policy>& other) : ptr_(other.ptr_), block_(other.block_) {
         if (block_) {
-            ++(block_->weak_refs);
+            block_->IncrementWeak();
+            PtrInstrumentation::Record<std::remove_extent_t<T>>(PtrInstrumentation::kWeak);
         }
     }
 
@@ -54,26 +59,26 @@ public:
     ///////////////////////////////////////////////////////////////////////
 
     WeakPtr& operator=(const WeakPtr& other) noexcept {
-        WeakPtr<T>(other).Swap(*this);
+        WeakPtr<T, Policy>(other).Swap(*this);
         return *this;
     }
-    template <typename Y>
-    WeakPtr& operator=(const WeakPtr<Y>& other) noexcept {
-        WeakPtr<T>(other).Swap(*this);
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    WeakPtr& operator=(const WeakPtr<Y, Policy>& other) noexcept {
+        WeakPtr<T, Policy>(other).Swap(*this);
         return *this;
     }
     WeakPtr& operator=(WeakPtr&& other) noexcept {
-        WeakPtr<T>(std::move(other)).Swap(*this);
+        WeakPtr<T, Policy>(std::move(other)).Swap(*this);
         return *this;
     }
-    template <typename Y>
-    WeakPtr& operator=(WeakPtr<Y>&& other) noexcept {
-        WeakPtr<T>(std::move(other)).Swap(*this);
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    WeakPtr& operator=(WeakPtr<Y, Policy>&& other) noexcept {
+        WeakPtr<T, Policy>(std::move(other)).Swap(*this);
         return *this;
     }
-    template <typename Y>
-    WeakPtr& operator=(const SharedPtr<Y>& sptr) noexcept {
-        WeakPtr<T>(sptr).Swap(*this);
+    template <typename Y, typename = std::enable_if_t<kIsCompatiblePtr<Y, T>>>
+    WeakPtr& operator=(const SharedPtr<Y, Policy>& sptr) noexcept {
+        WeakPtr<T, Policy>(sptr).Swap(*this);
         return *this;
     }
 
@@ -82,10 +87,7 @@ public:
 
     ~WeakPtr() {
         if (block_) {
-            --block_->weak_refs;
-            if (block_->shared_refs + block_->weak_refs == 0) {
-                delete block_;
-            }
+            block_->ReleaseWeak();
         }
     }
 
@@ -93,7 +95,7 @@ public:
     ///////////////////////////////////////////////////////////////////////
 
     void Reset() {
-        WeakPtr<T>().Swap(*this);
+        WeakPtr<T, Policy>().Swap(*this);
     }
     void Swap(WeakPtr& other) {
         std::swap(ptr_, other.ptr_);
@@ -105,18 +107,57 @@ public:
 
     size_t UseCount() const noexcept {
         if (block_) {
-            return block_->shared_refs;
+            return block_->SharedCount();
         }
         return 0;
     }
     bool Expired() const noexcept {
         return UseCount() == 0;
     }
-    SharedPtr<T> Lock() const noexcept {
-        if (Expired()) {
-            return SharedPtr<T>();
-        }
-        return SharedPtr<T>(*this);
+    SharedPtr<T, Policy> Lock() const noexcept {
+        return SharedPtr<T, Policy>(*this, std::nothrow);
     }
 };
 
+template <typename T, typename Policy>
+struct IsTriviallyRelocatable<WeakPtr<T, Policy>> : std::true_type {};
+
+// Lets an object owned by `SharedPtr` hand out further owners of itself
+//
+// The weak reference is set up by the constructor or factory that creates
+// the first owner, using the block it already allocated; `SharedFromThis()`
+// is then a single increment on that block.
+template <typename T, typename Policy>
+class EnableSharedFromThis {
+private:
+    mutable WeakPtr<T, Policy> weak_this_;
+
+    template <typename Y, typename P>
+    friend class SharedPtr;
+
+public:
+    // Throws `BadWeakPtr` if the object is not owned by a `SharedPtr`
+    SharedPtr<T, Policy> SharedFromThis() {
+        return SharedPtr<T, Policy>(weak_this_);
+    }
+    SharedPtr<const T, Policy> SharedFromThis() const {
+        return SharedPtr<const T, Policy>(weak_this_);
+    }
+
+    WeakPtr<T, Policy> WeakFromThis() noexcept {
+        return weak_this_;
+    }
+    WeakPtr<const T, Policy> WeakFromThis() const noexcept {
+        return weak_this_;
+    }
+
+protected:
+    EnableSharedFromThis() noexcept = default;
+    // A copy is a different object, not owned by the original's owners
+    EnableSharedFromThis(const EnableSharedFromThis&) noexcept {
+    }
+    EnableSharedFromThis& operator=(const EnableSharedFromThis&) noexcept {
+        return *this;
+    }
+    ~EnableSharedFromThis() = default;
+};
@@ -0,0 +1,349 @@
+#pragma once
+
+#include "hazard.h"
+#include "shared.h"
+#include "weak.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Map from keys to values that are alive only while someone else owns them
+//
+// Lookups walk a bucket chain under hazard pointers and promote the entry's
+// `WeakPtr` with a single increment-if-nonzero, taking no lock. A miss builds
+// the value once, however many threads miss at the same time; the others
+// wait for it. Values are made in control blocks of the cache's own, whose
+// last release erases the entry, so expired entries don't pile up.
+//
+// The bucket count is fixed at construction. Writers take the lock of the
+// bucket's shard.
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>, typename Policy = DefaultRefCount>
+class WeakCache {
+private:
+    struct Node {
+        K key;
+        WeakPtr<V, Policy> value;
+        // Identifies the entry to `Prune()`
+        const void* block;
+        std::atomic<Node*> next{nullptr};
+        // Links unlinked nodes that couldn't be retired yet
+        Node* unretired = nullptr;
+    };
+
+    // Result of a miss being built, shared by the threads waiting for it
+    struct Flight {
+        std::mutex mutex;
+        std::condition_variable built;
+        bool done = false;
+        SharedPtr<V, Policy> value;
+        std::exception_ptr error;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<K, SharedPtr<Flight>, Hash, KeyEqual> flights;
+    };
+
+    class Core;
+
+    // Holder block whose last release erases its entry
+    struct Entry : ControlBlock<Entry, Policy> {
+        std::aligned_storage_t<sizeof(V), alignof(V)> storage_;
+        Core* core_;
+        size_t hash_;
+
+        template <typename Factory>
+        Entry(Core* core, size_t hash, Factory& factory) : core_(core), hash_(hash) {
+            new (&storage_) V(factory());
+        }
+
+        void IfNoShared() noexcept {
+            Get()->~V();
+            core_->Prune(hash_, this);
+            core_->Release();
+        }
+
+        V* Get() {
+            return reinterpret_cast<V*>(&storage_);
+        }
+    };
+
+    // Outlives the cache while any of its values is alive
+    class Core {
+    public:
+        static constexpr size_t kShards = 16;
+
+        Hash hash;
+        KeyEqual equal;
+        std::vector<std::atomic<Node*>> buckets;
+        Shard shards[kShards];
+        std::atomic<size_t> refs{1};
+        std::atomic<Node*> unretired{nullptr};
+
+        Core(size_t bucket_count, const Hash& hash, const KeyEqual& equal)
+            : hash(hash), equal(equal), buckets(RoundUp(bucket_count)) {
+        }
+        ~Core() {
+            for (auto& bucket : buckets) {
+                for (Node* node = bucket.load(std::memory_order_relaxed); node;) {
+                    Node* next = node->next.load(std::memory_order_relaxed);
+                    delete node;
+                    node = next;
+                }
+            }
+            for (Node* node = unretired.load(std::memory_order_acquire); node;) {
+                Node* next = node->unretired;
+                delete node;
+                node = next;
+            }
+        }
+
+        void Release() noexcept {
+            if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+
+        std::atomic<Node*>& Bucket(size_t key_hash) noexcept {
+            return buckets[key_hash & (buckets.size() - 1)];
+        }
+        Shard& ShardOf(size_t key_hash) noexcept {
+            return shards[(key_hash & (buckets.size() - 1)) % kShards];
+        }
+
+        // Under the shard lock; returns the link pointing to the found node
+        template <typename Match>
+        std::atomic<Node*>* FindLink(size_t key_hash, Match match) noexcept {
+            std::atomic<Node*>* link = &Bucket(key_hash);
+            for (Node* node = link->load(std::memory_order_relaxed); node;
+                 node = link->load(std::memory_order_relaxed)) {
+                if (match(*node)) {
+                    return link;
+                }
+                link = &node->next;
+            }
+            return nullptr;
+        }
+        // Under the shard lock. A reader standing on the node stops there, as
+        // its successor may go away; it then finds the key through a lock.
+        static Node* Unlink(std::atomic<Node*>* link) noexcept {
+            Node* node = link->load(std::memory_order_relaxed);
+            link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            node->next.store(nullptr, std::memory_order_release);
+            return node;
+        }
+
+        // Never under a shard lock: reclaiming retired objects may release
+        // other values of this cache, which then prune themselves. Nodes
+        // that can't be retired for want of memory wait for the next call.
+        void Retire(Node* node) noexcept {
+            for (Node* kept = unretired.exchange(nullptr, std::memory_order_acquire); kept;) {
+                Node* next = kept->unretired;
+                RetireOrKeep(kept);
+                kept = next;
+            }
+            RetireOrKeep(node);
+        }
+
+        void Prune(size_t key_hash, const void* block) noexcept {
+            Node* node = nullptr;
+            {
+                std::lock_guard<std::mutex> guard(ShardOf(key_hash).mutex);
+                if (auto link = FindLink(key_hash, [block](const Node& node) {
+                        return node.block == block;
+                    })) {
+                    node = Unlink(link);
+                }
+            }
+            if (node) {
+                Retire(node);
+            }
+        }
+
+    private:
+        void RetireOrKeep(Node* node) noexcept {
+            try {
+                HazardPointers::Retire(node);
+            } catch (...) {
+                node->unretired = unretired.load(std::memory_order_relaxed);
+                while (!unretired.compare_exchange_weak(node->unretired, node,
+                                                        std::memory_order_release,
+                                                        std::memory_order_relaxed)) {
+                }
+            }
+        }
+
+        static size_t RoundUp(size_t count) noexcept {
+            size_t rounded = 1;
+            while (rounded < count) {
+                rounded *= 2;
+            }
+            return rounded;
+        }
+    };
+
+    Core* core_;
+
+public:
+    static constexpr size_t kDefaultBuckets = 1024;
+
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    explicit WeakCache(size_t bucket_count = kDefaultBuckets, const Hash& hash = Hash(),
+                       const KeyEqual& equal = KeyEqual())
+        : core_(new Core(bucket_count, hash, equal)) {
+    }
+    WeakCache(const WeakCache&) = delete;
+    WeakCache& operator=(const WeakCache&) = delete;
+
+    // Destructor
+    ///////////////////////////////////////////////////////////////////////
+
+    // Values still owned elsewhere stay valid
+    ~WeakCache() {
+        core_->Release();
+    }
+
+    // Operations
+    ///////////////////////////////////////////////////////////////////////
+
+    // Lock-free; may also come back empty while a neighbouring entry is
+    // being erased, `GetOrCreate()` double-checks under the lock
+    SharedPtr<V, Policy> Find(const K& key) const {
+        size_t key_hash = core_->hash(key);
+        HazardPointers::Guard guards[2];
+        size_t current = 0;
+        Node* node = guards[current].Protect(core_->Bucket(key_hash));
+        while (node) {
+            if (core_->equal(node->key, key)) {
+                return node->value.Lock();
+            }
+            current ^= 1;
+            node = guards[current].Protect(node->next);
+        }
+        return SharedPtr<V, Policy>();
+    }
+
+    // The live value for `key`, or a new one from `factory()`, called by one
+    // of the threads missing at once; its exceptions reach all of them
+    template <typename Factory>
+    SharedPtr<V, Policy> GetOrCreate(const K& key, Factory factory) {
+        if (auto value = Find(key)) {
+            return value;
+        }
+        size_t key_hash = core_->hash(key);
+        Shard& shard = core_->ShardOf(key_hash);
+        SharedPtr<V, Policy> value;
+        SharedPtr<Flight> flight;
+        bool building = false;
+        {
+            std::lock_guard<std::mutex> guard(shard.mutex);
+            if (auto link = FindLink(key, key_hash)) {
+                value = link->load(std::memory_order_relaxed)->value.Lock();
+            }
+            if (!value) {
+                auto found = shard.flights.find(key);
+                if (found != shard.flights.end()) {
+                    flight = found->second;
+                } else {
+                    flight = MakeShared<Flight>();
+                    shard.flights.emplace(key, flight);
+                    building = true;
+                }
+            }
+        }
+        if (value) {
+            return value;
+        }
+        if (!building) {
+            return Wait(*flight);
+        }
+
+        try {
+            value = Build(key, key_hash, factory);
+        } catch (...) {
+            SharedPtr<Flight> done = Land(shard, key);
+            std::lock_guard<std::mutex> guard(flight->mutex);
+            flight->error = std::current_exception();
+            flight->done = true;
+            flight->built.notify_all();
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> guard(flight->mutex);
+            flight->value = value;
+            flight->done = true;
+        }
+        flight->built.notify_all();
+        return value;
+    }
+
+private:
+    // Under the shard lock
+    std::atomic<Node*>* FindLink(const K& key, size_t key_hash) const noexcept {
+        return core_->FindLink(key_hash, [this, &key](const Node& node) {
+            return core_->equal(node.key, key);
+        });
+    }
+
+    static SharedPtr<V, Policy> Wait(Flight& flight) {
+        std::unique_lock<std::mutex> lock(flight.mutex);
+        flight.built.wait(lock, [&flight] {
+            return flight.done;
+        });
+        if (flight.error) {
+            std::rethrow_exception(flight.error);
+        }
+        return flight.value;
+    }
+
+    // Removes the flight; handed back so it is dropped outside the lock
+    static SharedPtr<Flight> Land(Shard& shard, const K& key) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        auto found = shard.flights.find(key);
+        SharedPtr<Flight> flight = std::move(found->second);
+        shard.flights.erase(found);
+        return flight;
+    }
+
+    template <typename Factory>
+    SharedPtr<V, Policy> Build(const K& key, size_t key_hash, Factory& factory) {
+        auto entry = new Entry(core_, key_hash, factory);
+        core_->refs.fetch_add(1, std::memory_order_relaxed);
+        SharedPtr<V, Policy> value(kAdoptNew, entry->Get(), entry);
+        auto node = new Node{key, value, entry};
+
+        Shard& shard = core_->ShardOf(key_hash);
+        SharedPtr<Flight> flight;
+        Node* expired = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(shard.mutex);
+            if (auto link = FindLink(key, key_hash)) {
+                // Expired, or it would have been found
+                expired = Core::Unlink(link);
+            }
+            std::atomic<Node*>& bucket = core_->Bucket(key_hash);
+            node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            bucket.store(node, std::memory_order_release);
+            auto found = shard.flights.find(key);
+            flight = std::move(found->second);
+            shard.flights.erase(found);
+        }
+        if (expired) {
+            core_->Retire(expired);
+        }
+        return value;
+    }
+};
@@ -0,0 +1,60 @@
+// Array ownership only converts where indexing stays right
+#include "shared-ptr/shared.h"
+#include "shared-ptr/shared_ref.h"
+#include "shared-ptr/weak.h"
+
+#include <cstdio>
+#include <type_traits>
+
+struct Base {
+    int base = 0;
+};
+struct Derived : Base {
+    int derived = 0;
+};
+
+// Raw pointers
+static_assert(std::is_constructible_v<SharedPtr<Base>, Derived*>);
+static_assert(std::is_constructible_v<SharedPtr<Base[]>, Base*>);
+static_assert(std::is_constructible_v<SharedPtr<const Base[]>, Base*>);
+static_assert(!std::is_constructible_v<SharedPtr<Base[]>, Derived*>);
+static_assert(!std::is_constructible_v<SharedPtr<Base[]>, Derived*, Slug<Derived[]>>);
+static_assert(!std::is_constructible_v<SharedPtr<Base[4]>, Derived*>);
+static_assert(!std::is_constructible_v<SharedPtr<Base>, const Base*>);
+
+// Conversions between pointers
+static_assert(std::is_convertible_v<SharedPtr<Derived>, SharedPtr<Base>>);
+static_assert(std::is_convertible_v<SharedPtr<int[]>, SharedPtr<const int[]>>);
+static_assert(std::is_convertible_v<SharedPtr<int[4]>, SharedPtr<int[]>>);
+static_assert(!std::is_convertible_v<SharedPtr<Derived[]>, SharedPtr<Base[]>>);
+static_assert(!std::is_convertible_v<const SharedPtr<Derived[]>&, SharedPtr<Base[]>>);
+static_assert(!std::is_convertible_v<SharedPtr<int>, SharedPtr<int[]>>);
+static_assert(!std::is_convertible_v<SharedPtr<int[]>, SharedPtr<int>>);
+static_assert(!std::is_assignable_v<SharedPtr<Base[]>&, SharedPtr<Derived[]>>);
+static_assert(!std::is_assignable_v<SharedPtr<Base[]>&, const SharedPtr<Derived[]>&>);
+static_assert(!std::is_convertible_v<UniquePtr<Derived[]>, SharedPtr<Base[]>>);
+static_assert(!std::is_convertible_v<UniquePtr<int>, SharedPtr<int[]>>);
+static_assert(std::is_convertible_v<UniquePtr<int[]>, SharedPtr<int[]>>);
+static_assert(!std::is_convertible_v<SharedPtr<Derived[]>, WeakPtr<Base[]>>);
+static_assert(!std::is_convertible_v<WeakPtr<Derived[]>, WeakPtr<Base[]>>);
+static_assert(std::is_convertible_v<SharedPtr<Derived>, WeakPtr<Base>>);
+
+// Borrowed views
+template <typename T>
+using Ref = SharedRef<T, DefaultRefCount>;
+
+static_assert(std::is_convertible_v<const SharedPtr<Derived>&, Ref<Base>>);
+static_assert(std::is_convertible_v<const SharedPtr<int[]>&, Ref<const int[]>>);
+static_assert(std::is_convertible_v<Ref<Derived>, Ref<Base>>);
+static_assert(!std::is_convertible_v<const SharedPtr<Derived[]>&, Ref<Base[]>>);
+static_assert(!std::is_convertible_v<Ref<Derived[]>, Ref<Base[]>>);
+static_assert(!std::is_convertible_v<const SharedPtr<int>&, Ref<int[]>>);
+static_assert(!std::is_convertible_v<Ref<Base>, Ref<Derived>>);
+
+int main() {
+    SharedPtr<const Base[]> elements = SharedPtr<Base[]>(new Base[3]);
+    SharedPtr<Base> base = SharedPtr<Derived>(new Derived);
+    WeakPtr<const Base[]> weak = elements;
+    std::puts(weak.Lock() && base ? "array_conversion_test: ok" : "array_conversion_test: FAILED");
+    return weak.Lock() && base ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+// Biased blocks released away from their owner thread, merged at the owner's
+// exit and handed around while the owner drops its own references
+#include "shared-ptr/biased.h"
+#include "shared-ptr/shared.h"
+#include "shared-ptr/weak.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                            \
+            std::abort();                                                        \
+        }                                                                        \
+    } while (false)
+
+template <typename T>
+using Biased = SharedPtr<T, BiasedRefCount>;
+
+std::atomic<int> alive{0};
+
+struct Node {
+    Biased<int> child;
+
+    Node() : child(MakeShared<int, BiasedRefCount>(1)) {
+        alive.fetch_add(1, std::memory_order_relaxed);
+    }
+    ~Node() {
+        CHECK(*child == 1);
+        alive.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+// The owner's exit merges a block released elsewhere; destroying its object
+// releases another block of the exiting thread
+void TestNestedAtExit() {
+    Biased<Node> handed;
+    std::thread([&handed] {
+        handed = MakeShared<Node, BiasedRefCount>();
+        std::thread([&handed] {
+            handed.Reset();
+        }).join();
+    }).join();
+    CHECK(alive.load() == 0);
+}
+
+// The last reference goes on another thread while the owner merges
+void TestCrossThreadRelease() {
+    constexpr int kRounds = 2000;
+    std::atomic<bool> stop{false};
+    std::vector<Biased<Node>> slots(kRounds);
+    std::atomic<int> published{0};
+    std::thread releaser([&] {
+        for (int i = 0; i < kRounds; ++i) {
+            while (published.load(std::memory_order_acquire) <= i) {
+            }
+            slots[i].Reset();
+        }
+        stop.store(true, std::memory_order_release);
+    });
+    std::thread owner([&] {
+        for (int i = 0; i < kRounds; ++i) {
+            Biased<Node> node = MakeShared<Node, BiasedRefCount>();
+            WeakPtr<Node, BiasedRefCount> weak = node;
+            slots[i] = node;
+            published.store(i + 1, std::memory_order_release);
+            node.Reset();
+            BiasedRefCount::MergeQueued();
+        }
+        while (!stop.load(std::memory_order_acquire)) {
+            BiasedRefCount::MergeQueued();
+        }
+    });
+    releaser.join();
+    owner.join();
+    CHECK(alive.load() == 0);
+}
+
+// A weak reference elsewhere can't bring back an object queued to its owner
+// with no references left
+void TestLockAfterQueue() {
+    Biased<Node> handed;
+    WeakPtr<Node, BiasedRefCount> weak;
+    std::atomic<bool> made{false};
+    std::atomic<bool> checked{false};
+    std::thread owner([&] {
+        handed = MakeShared<Node, BiasedRefCount>();
+        weak = handed;
+        made.store(true, std::memory_order_release);
+        while (!checked.load(std::memory_order_acquire)) {
+        }
+    });
+    while (!made.load(std::memory_order_acquire)) {
+    }
+    handed.Reset();
+    CHECK(!weak.Lock());
+    checked.store(true, std::memory_order_release);
+    owner.join();
+    CHECK(alive.load() == 0);
+    CHECK(!weak.Lock());
+}
+
+int main() {
+    TestNestedAtExit();
+    TestCrossThreadRelease();
+    TestLockAfterQueue();
+    std::puts("biased_test: ok");
+}
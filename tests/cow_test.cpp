@@ -0,0 +1,42 @@
+// Writes through empty, unique and shared copy-on-write pointers
+#include "shared-ptr/cow.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                            \
+            std::abort();                                                        \
+        }                                                                        \
+    } while (false)
+
+struct Document {
+    std::string text;
+    int version = 0;
+};
+
+int main() {
+    CowPtr<Document> empty;
+    empty.Write().version = 1;
+    CHECK(empty && empty->version == 1 && empty->text.empty() && empty.IsUnique());
+
+    CowPtr<Document> reset = MakeCow<Document>("draft", 2);
+    reset.Reset();
+    reset.Write().text = "again";
+    CHECK(reset->text == "again" && reset->version == 0);
+
+    CowPtr<Document> original = MakeCow<Document>("shared", 3);
+    const Document* before = original.Get();
+    original.Write().version = 4;
+    CHECK(original.Get() == before);
+    CowPtr<Document> copy = original;
+    copy.Write().text = "changed";
+    CHECK(copy.Get() != before && original.Get() == before);
+    CHECK(original->text == "shared" && copy->text == "changed" && copy->version == 4);
+    CHECK(original.IsUnique() && copy.IsUnique());
+    std::puts("cow_test: ok");
+}
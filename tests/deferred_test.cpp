@@ -0,0 +1,121 @@
+// Last release of deferred objects through every policy: the block must
+// outlive the destruction running on the reclaimer thread
+#include "shared-ptr/biased.h"
+#include "shared-ptr/deferred.h"
+#include "shared-ptr/release.h"
+#include "shared-ptr/weak.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Freed memory is overwritten, so a destructor running on a freed block
+// finds its canary gone even without a sanitizer
+void* operator new(size_t size) {
+    auto memory = static_cast<size_t*>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    *memory = size;
+    return reinterpret_cast<char*>(memory) + sizeof(std::max_align_t);
+}
+void operator delete(void* ptr) noexcept {
+    if (ptr) {
+        auto memory = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(std::max_align_t));
+        std::memset(ptr, 0xdd, *memory);
+        std::free(memory);
+    }
+}
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                            \
+            std::abort();                                                        \
+        }                                                                        \
+    } while (false)
+
+constexpr unsigned kCanary = 0x600dcafe;
+
+int destroyed = 0;
+
+struct Tracked {
+    unsigned canary = kCanary;
+
+    ~Tracked() {
+        CHECK(canary == kCanary);
+        canary = 0;
+        ++destroyed;
+    }
+};
+
+template <typename Policy>
+void TestLastOwner(Reclaimer& reclaimer) {
+    destroyed = 0;
+    {
+        SharedPtr<Tracked, Policy> owner = MakeSharedDeferredIn<Tracked, Policy>(reclaimer);
+    }
+    reclaimer.Flush();
+    BiasedRefCount::MergeQueued();
+    reclaimer.Flush();
+    CHECK(destroyed == 1);
+}
+
+template <typename Policy>
+void TestObserved(Reclaimer& reclaimer) {
+    destroyed = 0;
+    WeakPtr<Tracked, Policy> weak;
+    {
+        SharedPtr<Tracked, Policy> owner = MakeSharedDeferredIn<Tracked, Policy>(reclaimer);
+        weak = owner;
+    }
+    reclaimer.Flush();
+    BiasedRefCount::MergeQueued();
+    reclaimer.Flush();
+    CHECK(destroyed == 1);
+    CHECK(weak.Expired());
+}
+
+template <typename Policy>
+void TestReleaseAll(Reclaimer& reclaimer) {
+    constexpr int kCount = 100;
+    destroyed = 0;
+    std::vector<SharedPtr<Tracked, Policy>> owners;
+    for (int i = 0; i < kCount; ++i) {
+        owners.push_back(MakeSharedDeferredIn<Tracked, Policy>(reclaimer));
+    }
+    // Every other object also has a second owner, dropped afterwards
+    std::vector<SharedPtr<Tracked, Policy>> others;
+    for (int i = 0; i < kCount; i += 2) {
+        others.push_back(owners[i]);
+    }
+    ReleaseAll(owners);
+    CHECK(owners.empty());
+    ReleaseAll(others);
+    reclaimer.Flush();
+    BiasedRefCount::MergeQueued();
+    reclaimer.Flush();
+    CHECK(destroyed == kCount);
+}
+
+template <typename Policy>
+void TestPolicy() {
+    Reclaimer reclaimer;
+    TestLastOwner<Policy>(reclaimer);
+    TestObserved<Policy>(reclaimer);
+    TestReleaseAll<Policy>(reclaimer);
+}
+
+int main() {
+    TestPolicy<SingleThreadedRefCount>();
+    TestPolicy<AtomicRefCount>();
+    TestPolicy<PackedAtomicRefCount>();
+    TestPolicy<BiasedRefCount>();
+    std::puts("deferred_test: ok");
+}
@@ -0,0 +1,48 @@
+// Retiring a pruned entry may reclaim the last owners of other entries of the
+// same shard, which prune those in turn
+#include "shared-ptr/weak_cache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #condition);                                            \
+            std::abort();                                                        \
+        }                                                                        \
+    } while (false)
+
+int main() {
+    constexpr int kHeld = 40;
+    constexpr int kDropped = 100;
+    // A single bucket, so every entry is in the same shard
+    WeakCache<int, int> cache(1);
+    std::vector<SharedPtr<int>> values;
+    for (int key = 0; key < kHeld + kDropped; ++key) {
+        values.push_back(cache.GetOrCreate(key, [key] {
+            return key * 2;
+        }));
+    }
+    HazardPointers::Reclaim();
+
+    // The last owners of these go only when a scan reclaims them
+    for (int key = 0; key < kHeld; ++key) {
+        HazardPointers::Retire(new SharedPtr<int>(std::move(values[key])));
+    }
+    for (int key = kHeld; key < kHeld + kDropped; ++key) {
+        values[key].Reset();
+    }
+    HazardPointers::Reclaim();
+
+    for (int key = 0; key < kHeld + kDropped; ++key) {
+        CHECK(!cache.Find(key));
+    }
+    auto again = cache.GetOrCreate(0, [] {
+        return 7;
+    });
+    CHECK(*again == 7 && cache.Find(0) == again);
+    std::puts("weak_cache_test: ok");
+}
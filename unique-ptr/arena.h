@@ -0,0 +1,176 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Monotonic arena: allocation is a pointer bump in the current chunk, and
+// nothing is freed before `Reset()` or the arena's destruction
+//
+// `Reset()` rewinds over all chunks at once, keeping them for reuse; every
+// pointer the arena handed out is invalid from then on. Not thread-safe:
+// give each thread its own, as `ThreadLocal()` does.
+class Arena {
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t size;
+
+        char* Begin() noexcept {
+            return reinterpret_cast<char*>(this + 1);
+        }
+        char* End() noexcept {
+            return Begin() + size;
+        }
+    };
+
+    size_t chunk_size_;
+    Chunk* first_ = nullptr;
+    Chunk* current_ = nullptr;
+    uintptr_t cursor_ = 0;
+    uintptr_t end_ = 0;
+
+public:
+    static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+    explicit Arena(size_t chunk_size = kDefaultChunkSize) noexcept : chunk_size_(chunk_size) {
+    }
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() {
+        while (first_) {
+            Chunk* next = first_->next;
+            ::operator delete(first_);
+            first_ = next;
+        }
+    }
+
+    static Arena& ThreadLocal() {
+        thread_local Arena arena;
+        return arena;
+    }
+
+    void* Allocate(size_t size, size_t alignment) {
+        uintptr_t result = AlignUp(cursor_, alignment);
+        if (cursor_ != 0 && result <= end_ && size <= end_ - result) {
+            cursor_ = result + size;
+            return reinterpret_cast<void*>(result);
+        }
+        return AllocateSlow(size, alignment);
+    }
+
+    void Reset() noexcept {
+        current_ = first_;
+        Enter(first_);
+    }
+
+private:
+    static uintptr_t AlignUp(uintptr_t address, size_t alignment) noexcept {
+        return (address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    }
+
+    void Enter(Chunk* chunk) noexcept {
+        cursor_ = chunk ? reinterpret_cast<uintptr_t>(chunk->Begin()) : 0;
+        end_ = chunk ? reinterpret_cast<uintptr_t>(chunk->End()) : 0;
+    }
+
+    // Moves on to the next kept chunk big enough, or to a new one after the
+    // current chunk
+    void* AllocateSlow(size_t size, size_t alignment) {
+        if (size > SIZE_MAX - sizeof(Chunk) - alignment) {
+            throw std::bad_alloc();
+        }
+        for (Chunk* chunk = current_ ? current_->next : first_; chunk; chunk = chunk->next) {
+            if (size + alignment <= chunk->size) {
+                current_ = chunk;
+                Enter(chunk);
+                return Allocate(size, alignment);
+            }
+        }
+        size_t chunk_size = size + alignment > chunk_size_ ? size + alignment : chunk_size_;
+        auto chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + chunk_size));
+        chunk->size = chunk_size;
+        if (current_) {
+            chunk->next = current_->next;
+            current_->next = chunk;
+        } else {
+            chunk->next = first_;
+            first_ = chunk;
+        }
+        current_ = chunk;
+        Enter(chunk);
+        return Allocate(size, alignment);
+    }
+};
+
+// Deleter of arena objects: runs the destructor and leaves the memory to the
+// arena. Empty, so an `ArenaPtr` is one pointer whichever arena it came from;
+// for trivially destructible types it does nothing and may outlive a reset.
+template <typename T>
+struct ArenaDelete {
+    void operator()(T* ptr) const noexcept {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            ptr->~T();
+        }
+    }
+};
+
+// The element count of a non-trivial array sits right before its elements
+template <typename T>
+struct ArenaDelete<T[]> {
+    static constexpr size_t kHeaderSize =
+        (sizeof(size_t) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    void operator()(T* ptr) const noexcept {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            size_t count = *reinterpret_cast<size_t*>(reinterpret_cast<char*>(ptr) - kHeaderSize);
+            for (size_t i = count; i > 0; --i) {
+                ptr[i - 1].~T();
+            }
+        }
+    }
+};
+
+template <typename T>
+using ArenaPtr = UniquePtr<T, ArenaDelete<T>>;
+
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, ArenaPtr<T>> MakeUniqueIn(Arena& arena, Args&&... args) {
+    void* memory = arena.Allocate(sizeof(T), alignof(T));
+    return ArenaPtr<T>(new (memory) T{std::forward<Args>(args)...});
+}
+// Elements are value-initialized
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, ArenaPtr<T>> MakeUniqueIn(
+    Arena& arena, size_t count) {
+    using Element = std::remove_extent_t<T>;
+    constexpr size_t kHeaderSize =
+        std::is_trivially_destructible_v<Element> ? 0 : ArenaDelete<T>::kHeaderSize;
+    constexpr size_t kAlignment =
+        alignof(Element) > alignof(size_t) ? alignof(Element) : alignof(size_t);
+    if (count > (SIZE_MAX - kHeaderSize) / sizeof(Element)) {
+        throw std::bad_array_new_length();
+    }
+    auto memory = static_cast<char*>(arena.Allocate(kHeaderSize + count * sizeof(Element),
+                                                    kAlignment));
+    auto elements = reinterpret_cast<Element*>(memory + kHeaderSize);
+    size_t constructed = 0;
+    try {
+        for (; constructed < count; ++constructed) {
+            new (elements + constructed) Element();
+        }
+    } catch (...) {
+        for (size_t i = constructed; i > 0; --i) {
+            elements[i - 1].~Element();
+        }
+        throw;
+    }
+    if constexpr (kHeaderSize != 0) {
+        new (memory) size_t(count);
+    }
+    return ArenaPtr<T>(elements);
+}
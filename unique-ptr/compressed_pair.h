@@ -1,10 +1,18 @@
 #pragma once
 
 #include <cstddef>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
+// Tag for default- rather than value-initializing an object, e.g. storage
+// that is constructed into later
+struct DefaultInitTag {};
+
+// Element `I` of a `CompressedTuple`; empty non-final types are stored as a
+// base class, so they take no space
 template <typename T, size_t I, bool = std::is_empty<T>::value && !std::is_final<T>::value >
-class CompressedPairElement {
+class CompressedTupleElement {
 private:
     T elem;
 
@@ -12,68 +20,136 @@ public:
     // Constructors
     ///////////////////////////////////////////////////////////////////////
 
-    CompressedPairElement() : elem(T()) {
+    CompressedTupleElement() noexcept(std::is_nothrow_default_constructible_v<T>) : elem() {
+    }
+    CompressedTupleElement(DefaultInitTag) noexcept(std::is_nothrow_default_constructible_v<T>) {
     }
     template <typename Type>
-    CompressedPairElement(Type&& other_elem) : elem(std::forward<Type>(other_elem)) {
+    CompressedTupleElement(Type&& other_elem) noexcept(
+        std::is_nothrow_constructible_v<T, Type&&>)
+        : elem(std::forward<Type>(other_elem)) {
     }
 
     // Observers
     ///////////////////////////////////////////////////////////////////////
 
-    T& Get() {
+    T& Get() noexcept {
         return elem;
     }
-    const T& Get() const {
+    const T& Get() const noexcept {
         return elem;
     }
 };
 
 template <typename T, size_t I>
-class CompressedPairElement<T, I, true> : public T {
+class CompressedTupleElement<T, I, true> : public T {
+public:
     // Constructors
     ///////////////////////////////////////////////////////////////////////
-    CompressedPairElement(){};
-    template <typename Tt>
-    CompressedPairElement(Tt&&) {
+
+    CompressedTupleElement() noexcept(std::is_nothrow_default_constructible_v<T>) : T() {
+    }
+    CompressedTupleElement(DefaultInitTag) noexcept(std::is_nothrow_default_constructible_v<T>) {
+    }
+    template <typename Type>
+    CompressedTupleElement(Type&& other_elem) noexcept(
+        std::is_nothrow_constructible_v<T, Type&&>)
+        : T(std::forward<Type>(other_elem)) {
     }
 
     // Observers
     ///////////////////////////////////////////////////////////////////////
-    T& Get() {
+
+    T& Get() noexcept {
         return *this;
     }
-    const T& Get() const {
+    const T& Get() const noexcept {
         return *this;
     }
 };
 
+template <typename Indices, typename... Ts>
+class CompressedTupleBase;
+
+template <size_t... Is, typename... Ts>
+class CompressedTupleBase<std::index_sequence<Is...>, Ts...>
+    : public CompressedTupleElement<Ts, Is>... {
+public:
+    CompressedTupleBase() noexcept((std::is_nothrow_default_constructible_v<Ts> && ...))
+        : CompressedTupleElement<Ts, Is>()... {
+    }
+    template <typename... Us>
+    CompressedTupleBase(std::in_place_t, Us&&... elems) noexcept(
+        (std::is_nothrow_constructible_v<Ts, Us&&> && ...))
+        : CompressedTupleElement<Ts, Is>(std::forward<Us>(elems))... {
+    }
+};
+
+// Tuple in which empty elements (stateless deleters, allocators) take no space
+template <typename... Ts>
+class CompressedTuple : CompressedTupleBase<std::index_sequence_for<Ts...>, Ts...> {
+private:
+    using Base = CompressedTupleBase<std::index_sequence_for<Ts...>, Ts...>;
+
+    template <size_t I>
+    using Element = CompressedTupleElement<std::tuple_element_t<I, std::tuple<Ts...>>, I>;
+
+    template <typename... Us>
+    static constexpr bool kIsElementwise =
+        sizeof...(Us) == sizeof...(Ts) && sizeof...(Us) > 0 &&
+        !(sizeof...(Us) == 1 && (std::is_same_v<std::decay_t<Us>, CompressedTuple> && ...));
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    CompressedTuple() noexcept(std::is_nothrow_default_constructible_v<Base>) : Base() {
+    }
+    template <typename... Us, typename = std::enable_if_t<kIsElementwise<Us...>>>
+    CompressedTuple(Us&&... elems) noexcept(
+        std::is_nothrow_constructible_v<Base, std::in_place_t, Us&&...>)
+        : Base(std::in_place, std::forward<Us>(elems)...) {
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    template <size_t I>
+    auto& Get() noexcept {
+        return static_cast<Element<I>&>(*this).Get();
+    }
+    template <size_t I>
+    const auto& Get() const noexcept {
+        return static_cast<const Element<I>&>(*this).Get();
+    }
+};
+
 template <typename F, typename S>
-class CompressedPair : CompressedPairElement<F, 0>, CompressedPairElement<S, 1> {
+class CompressedPair : CompressedTuple<F, S> {
 public:
-    CompressedPair() : CompressedPairElement<F, 0>(), CompressedPairElement<S, 1>() {
+    CompressedPair() noexcept(std::is_nothrow_default_constructible_v<CompressedTuple<F, S>>)
+        : CompressedTuple<F, S>() {
     }
 
     template <typename Ff, typename Ss>
-    CompressedPair(Ff&& first, Ss&& second)
-        : CompressedPairElement<F, 0>(std::forward<Ff>(first)),
-          CompressedPairElement<S, 1>(std::forward<Ss>(second)) {
+    CompressedPair(Ff&& first, Ss&& second) noexcept(
+        std::is_nothrow_constructible_v<CompressedTuple<F, S>, Ff&&, Ss&&>)
+        : CompressedTuple<F, S>(std::forward<Ff>(first), std::forward<Ss>(second)) {
     }
 
-    F& GetFirst() {
-        return CompressedPairElement<F, 0>::Get();
+    F& GetFirst() noexcept {
+        return this->template Get<0>();
     }
 
-    const F& GetFirst() const {
-        return CompressedPairElement<F, 0>::Get();
+    const F& GetFirst() const noexcept {
+        return this->template Get<0>();
     }
 
-    S& GetSecond() {
-        return CompressedPairElement<S, 1>::Get();
+    S& GetSecond() noexcept {
+        return this->template Get<1>();
     }
 
-    const S& GetSecond() const {
-        return CompressedPairElement<S, 1>::Get();
+    const S& GetSecond() const noexcept {
+        return this->template Get<1>();
     }
 };
-
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Compile-time switch for counting what the smart pointers do
+//
+// Build with `-DSMART_PTRS_INSTRUMENT=1`, the same in every translation unit,
+// to get per-pointee-type counters and a live control block gauge. Threads
+// count into their own slots, which `Snapshot()` sums up; a leak report is
+// printed at exit if objects or blocks are still alive. Otherwise every hook
+// is an empty inline function.
+//
+// Hooks run in pointer copies and destructors, so they never throw: an event
+// that finds no memory for its counters is dropped.
+#ifndef SMART_PTRS_INSTRUMENT
+#define SMART_PTRS_INSTRUMENT 0
+#endif
+
+#if SMART_PTRS_INSTRUMENT
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#endif
+#endif
+
+class PtrInstrumentation {
+public:
+    enum Event : size_t {
+        // A pointer started owning a new object
+        kMake,
+        kCopy,
+        kMove,
+        // A `WeakPtr` made or copied
+        kWeak,
+        kLock,
+        kFailedLock,
+        // An object destroyed, or released from its owner
+        kRelease,
+        kEventCount,
+    };
+
+    struct Counters {
+        uint64_t events[kEventCount] = {};
+
+        int64_t Live() const noexcept {
+            return static_cast<int64_t>(events[kMake] - events[kRelease]);
+        }
+    };
+
+    static constexpr bool kEnabled = SMART_PTRS_INSTRUMENT;
+
+#if SMART_PTRS_INSTRUMENT
+    struct TypeCounters {
+        std::string type;
+        Counters counters;
+    };
+
+    template <typename T>
+    static void Record(Event event) noexcept {
+        try {
+            Count(TypeId<T>(), event);
+        } catch (...) {
+        }
+    }
+    static void BlockCreated() noexcept {
+        Count(kBlockType, kMake);
+    }
+    static void BlockFreed() noexcept {
+        Count(kBlockType, kRelease);
+    }
+
+    // Base of control blocks: remembers whose counters the object's
+    // destruction goes to, wherever that ends up happening
+    class BlockTag {
+    private:
+        size_t type_ = kBlockType;
+
+    public:
+        // Unless the type can't be registered; the release is then not
+        // counted either
+        template <typename T>
+        void RecordMake() noexcept {
+            try {
+                type_ = TypeId<T>();
+            } catch (...) {
+                return;
+            }
+            Count(type_, kMake);
+        }
+        void RecordRelease() const noexcept {
+            if (type_ != kBlockType) {
+                Count(type_, kRelease);
+            }
+        }
+    };
+
+    // Totals over all threads, past and present, for the types seen so far
+    static std::vector<TypeCounters> Snapshot() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        std::vector<TypeCounters> result(registry.types.size());
+        for (size_t id = 0; id < result.size(); ++id) {
+            result[id].type = Demangle(registry.types[id]);
+            registry.retired.AddTo(id, result[id].counters);
+            for (ThreadCounters* thread : registry.threads) {
+                thread->AddTo(id, result[id].counters);
+            }
+        }
+        result.erase(result.begin() + kBlockType);
+        return result;
+    }
+    static int64_t LiveBlocks() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        Counters blocks;
+        registry.retired.AddTo(kBlockType, blocks);
+        for (ThreadCounters* thread : registry.threads) {
+            thread->AddTo(kBlockType, blocks);
+        }
+        return blocks.Live();
+    }
+
+    static void Dump(std::ostream& out) {
+        static const char* const kNames[kEventCount] = {
+            "makes", "copies", "moves", "weak", "locks", "failed_locks", "releases"};
+        out << "live control blocks: " << LiveBlocks() << '\n';
+        for (const TypeCounters& type : Snapshot()) {
+            out << type.type << ':';
+            for (size_t event = 0; event < kEventCount; ++event) {
+                out << ' ' << kNames[event] << '=' << type.counters.events[event];
+            }
+            out << " live=" << type.counters.Live() << '\n';
+        }
+    }
+    // Returns `false` and lists the culprits if anything is still alive
+    static bool ReportLeaks(std::ostream& out) {
+        bool clean = true;
+        int64_t blocks = LiveBlocks();
+        if (blocks > 0) {
+            out << "leaked control blocks: " << blocks << '\n';
+            clean = false;
+        }
+        for (const TypeCounters& type : Snapshot()) {
+            if (type.counters.Live() > 0) {
+                out << "leaked " << type.type << ": " << type.counters.Live() << '\n';
+                clean = false;
+            }
+        }
+        return clean;
+    }
+
+private:
+    static constexpr size_t kMaxTypes = 1024;
+    static constexpr size_t kBlockType = 0;
+
+    struct Slot {
+        std::atomic<uint64_t> events[kEventCount] = {};
+    };
+
+    // Written by its thread only, with plain loads and stores
+    struct ThreadCounters {
+        std::atomic<Slot*> slots[kMaxTypes] = {};
+
+        ~ThreadCounters() {
+            for (auto& slot : slots) {
+                delete slot.load(std::memory_order_relaxed);
+            }
+        }
+
+        // Null if there is no memory for a new slot
+        Slot* Get(size_t id) noexcept {
+            Slot* slot = slots[id].load(std::memory_order_relaxed);
+            if (!slot) {
+                slot = new (std::nothrow) Slot;
+                slots[id].store(slot, std::memory_order_release);
+            }
+            return slot;
+        }
+        void AddTo(size_t id, Counters& counters) const noexcept {
+            if (Slot* slot = slots[id].load(std::memory_order_acquire)) {
+                for (size_t event = 0; event < kEventCount; ++event) {
+                    counters.events[event] += slot->events[event].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<const std::type_info*> types{&typeid(void)};
+        std::vector<ThreadCounters*> threads;
+        // Folded in from exited threads; also counts for threads past teardown
+        ThreadCounters retired;
+    };
+
+    static Registry& GetRegistry() {
+        // Never destroyed: pointers are released during static destruction
+        static Registry* registry = new Registry;
+        static struct LeakReport {
+            ~LeakReport() {
+                ReportLeaks(std::cerr);
+            }
+        } leak_report;
+        return *registry;
+    }
+
+    template <typename T>
+    static size_t TypeId() {
+        static const size_t id = RegisterType(typeid(T));
+        return id;
+    }
+    static size_t RegisterType(const std::type_info& type) {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        if (registry.types.size() == kMaxTypes) {
+            std::cerr << "PtrInstrumentation: more than " << kMaxTypes << " types\n";
+            std::abort();
+        }
+        registry.types.push_back(&type);
+        return registry.types.size() - 1;
+    }
+
+    static std::string Demangle(const std::type_info* type) {
+        if (type == &typeid(void)) {
+            return "control blocks";
+        }
+#if __has_include(<cxxabi.h>)
+        int status = 0;
+        std::unique_ptr<char, decltype(&std::free)> name(
+            abi::__cxa_demangle(type->name(), nullptr, nullptr, &status), &std::free);
+        if (status == 0) {
+            return name.get();
+        }
+#endif
+        return type->name();
+    }
+
+    struct ThreadHandle {
+        ThreadCounters counters;
+
+        ThreadHandle() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> guard(registry.mutex);
+            registry.threads.push_back(&counters);
+            local_counters = &counters;
+        }
+        ~ThreadHandle() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> guard(registry.mutex);
+            for (size_t id = 0; id < registry.types.size(); ++id) {
+                Counters exited;
+                counters.AddTo(id, exited);
+                Slot* slot = registry.retired.Get(id);
+                for (size_t event = 0; slot && event < kEventCount; ++event) {
+                    slot->events[event].fetch_add(exited.events[event], std::memory_order_relaxed);
+                }
+            }
+            auto& threads = registry.threads;
+            threads.erase(std::find(threads.begin(), threads.end(), &counters));
+            local_counters = nullptr;
+            torn_down = true;
+        }
+    };
+
+    static inline thread_local ThreadCounters* local_counters = nullptr;
+    static inline thread_local bool torn_down = false;
+
+    static void Count(size_t id, Event event) noexcept {
+        try {
+            if (!local_counters && !torn_down) {
+                thread_local ThreadHandle handle;
+            }
+            if (local_counters) {
+                if (Slot* slot = local_counters->Get(id)) {
+                    std::atomic<uint64_t>& counter = slot->events[event];
+                    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+                }
+            } else {
+                Registry& registry = GetRegistry();
+                std::lock_guard<std::mutex> guard(registry.mutex);
+                if (Slot* slot = registry.retired.Get(id)) {
+                    slot->events[event].fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        } catch (...) {
+            // Registering the thread or locking failed
+        }
+    }
+#else
+    template <typename T>
+    static void Record(Event) noexcept {
+    }
+    static void BlockCreated() noexcept {
+    }
+    static void BlockFreed() noexcept {
+    }
+
+    class BlockTag {
+    public:
+        template <typename T>
+        void RecordMake() noexcept {
+        }
+        void RecordRelease() const noexcept {
+        }
+    };
+
+    static int64_t LiveBlocks() noexcept {
+        return 0;
+    }
+    template <typename Stream>
+    static void Dump(Stream&) noexcept {
+    }
+    template <typename Stream>
+    static bool ReportLeaks(Stream&) noexcept {
+        return true;
+    }
+#endif
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "unique.h"
+
+#include <cstddef>
+
+// Non-owning pointer for passing an object down a call chain
+//
+// Documents that the callee only borrows: it neither frees the object nor
+// keeps it past the call. Costs exactly a raw pointer.
+template <typename T>
+class ObserverPtr {
+private:
+    T* ptr_;
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    ObserverPtr() noexcept : ptr_(nullptr) {
+    }
+    ObserverPtr(std::nullptr_t) noexcept : ptr_(nullptr) {
+    }
+    explicit ObserverPtr(T* ptr) noexcept : ptr_(ptr) {
+    }
+    template <typename Y, typename Deleter>
+    ObserverPtr(const UniquePtr<Y, Deleter>& owner) noexcept : ptr_(owner.Get()) {
+    }
+    template <typename Y>
+    ObserverPtr(ObserverPtr<Y> other) noexcept : ptr_(other.Get()) {
+    }
+
+    // Modifiers
+    ///////////////////////////////////////////////////////////////////////
+
+    void Reset(T* ptr = nullptr) noexcept {
+        ptr_ = ptr;
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    T* Get() const noexcept {
+        return ptr_;
+    }
+    T& operator*() const noexcept {
+        return *ptr_;
+    }
+    T* operator->() const noexcept {
+        return ptr_;
+    }
+    explicit operator bool() const noexcept {
+        return ptr_ != nullptr;
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(ObserverPtr<T> left, ObserverPtr<U> right) noexcept {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(ObserverPtr<T> left, ObserverPtr<U> right) noexcept {
+    return left.Get() != right.Get();
+}
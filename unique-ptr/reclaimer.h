@@ -0,0 +1,176 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ReclaimerStats {
+    // Handed to the background thread
+    size_t deferred = 0;
+    // Run on the releasing thread: queue full or reclaimer shut down
+    size_t inline_runs = 0;
+    size_t completed = 0;
+    size_t pending = 0;
+    size_t peak_pending = 0;
+};
+
+// Background thread running destructions handed off by other threads
+//
+// The queue is bounded: once `capacity` destructions are pending, callers run
+// theirs inline rather than wait, so memory held by dead objects stays
+// bounded too. The thread starts on the first `Defer()`.
+class Reclaimer {
+private:
+    struct Task {
+        void* ptr;
+        void (*reclaim)(void*) noexcept;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<Task> queue_;
+    size_t capacity_;
+    size_t running_ = 0;
+    bool stopped_ = false;
+    ReclaimerStats stats_;
+    std::thread thread_;
+
+public:
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    explicit Reclaimer(size_t capacity = kDefaultCapacity) : capacity_(capacity) {
+        queue_.reserve(capacity_);
+    }
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+    ~Reclaimer() {
+        Shutdown();
+    }
+
+    // Used by `DeferredDelete`; shut down, and from then on inline, at exit
+    static Reclaimer& Default() {
+        static Reclaimer* reclaimer = new Reclaimer;
+        static struct ShutdownAtExit {
+            ~ShutdownAtExit() {
+                reclaimer->Shutdown();
+            }
+        } shutdown_at_exit;
+        return *reclaimer;
+    }
+
+    // Eventually calls `reclaim(ptr)`, on the background thread if possible
+    void Defer(void* ptr, void (*reclaim)(void*) noexcept) noexcept {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopped_ || queue_.size() >= capacity_ || !Start()) {
+            ++stats_.inline_runs;
+            lock.unlock();
+            reclaim(ptr);
+            return;
+        }
+        queue_.push_back({ptr, reclaim});
+        ++stats_.deferred;
+        if (queue_.size() > stats_.peak_pending) {
+            stats_.peak_pending = queue_.size();
+        }
+        if (queue_.size() == 1) {
+            wake_.notify_one();
+        }
+    }
+    template <typename T>
+    void Defer(T* ptr) noexcept {
+        Defer(ptr, [](void* deferred) noexcept {
+            delete static_cast<T*>(deferred);
+        });
+    }
+
+    // Waits for everything deferred so far to be reclaimed
+    void Flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] {
+            return queue_.empty() && running_ == 0;
+        });
+    }
+
+    // Reclaims what's pending and stops the thread; later `Defer()`-s run inline
+    void Shutdown() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopped_ = true;
+        wake_.notify_one();
+        lock.unlock();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    ReclaimerStats Stats() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ReclaimerStats stats = stats_;
+        stats.pending = queue_.size() + running_;
+        return stats;
+    }
+
+private:
+    // Under `mutex_`; `false` if the thread can't be started
+    bool Start() noexcept {
+        if (thread_.joinable()) {
+            return true;
+        }
+        try {
+            thread_ = std::thread([this] {
+                Run();
+            });
+        } catch (...) {
+            return false;
+        }
+        return true;
+    }
+
+    void Run() {
+        std::vector<Task> batch;
+        batch.reserve(capacity_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this] {
+                return stopped_ || !queue_.empty();
+            });
+            if (queue_.empty()) {
+                return;
+            }
+            batch.swap(queue_);
+            running_ = batch.size();
+            lock.unlock();
+            // Destructors may defer more objects, so they run unlocked
+            for (const Task& task : batch) {
+                task.reclaim(task.ptr);
+            }
+            lock.lock();
+            stats_.completed += batch.size();
+            running_ = 0;
+            batch.clear();
+            if (queue_.empty()) {
+                idle_.notify_all();
+            }
+        }
+    }
+};
+
+// Deleter handing the object to `Reclaimer::Default()`; empty, so a
+// `UniquePtr` using it stays one pointer
+template <typename T>
+struct DeferredDelete {
+    void operator()(T* ptr) const noexcept {
+        Reclaimer::Default().Defer(ptr);
+    }
+};
+
+template <typename T>
+struct DeferredDelete<T[]> {
+    void operator()(T* ptr) const noexcept {
+        Reclaimer::Default().Defer(ptr, [](void* deferred) noexcept {
+            delete[] static_cast<T*>(deferred);
+        });
+    }
+};
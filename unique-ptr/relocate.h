@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Opt-in: moving a `T` to new storage and ending the old one's lifetime can
+// be done by copying its bytes. True for trivially copyable types; smart
+// pointers specialize it, for containers that grow with `Relocate`.
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<T>::value;
+
+// Moves `count` objects from `source` into raw storage at `target`, leaving
+// `source` as raw storage; the ranges must not overlap
+template <typename T>
+void Relocate(T* source, size_t count, T* target) noexcept {
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        if (count) {
+            std::memcpy(static_cast<void*>(target), static_cast<const void*>(source),
+                        count * sizeof(T));
+        }
+    } else {
+        static_assert(std::is_nothrow_move_constructible_v<T>,
+                      "`Relocate` needs trivially relocatable or nothrow movable types");
+        for (size_t i = 0; i < count; ++i) {
+            new (target + i) T(std::move(source[i]));
+            source[i].~T();
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "unique.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+// Pointer word whose low `Bits` bits, zero in any pointer aligned to
+// `1 << Bits`, hold a user tag
+//
+// Tag operations are atomic read-modify-writes of the whole word and leave
+// the pointer alone, so other threads may flip flags while the owner reads.
+// Changing the pointer is for the owner only; the tag is kept across it.
+template <size_t Bits>
+class TaggedWord {
+public:
+    static constexpr uintptr_t kTagMask = (uintptr_t{1} << Bits) - 1;
+
+private:
+    static_assert(Bits > 0 && Bits < sizeof(uintptr_t) * 8, "Bits out of range");
+
+    std::atomic<uintptr_t> word_;
+
+public:
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    explicit TaggedWord(uintptr_t word = 0) noexcept : word_(word) {
+    }
+    TaggedWord(const TaggedWord&) = delete;
+    TaggedWord& operator=(const TaggedWord&) = delete;
+
+    template <typename T>
+    static uintptr_t Pack(T* ptr, uintptr_t tag) noexcept {
+        return reinterpret_cast<uintptr_t>(ptr) | (tag & kTagMask);
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    uintptr_t Load() const noexcept {
+        return word_.load(std::memory_order_acquire);
+    }
+    template <typename T>
+    T* Pointer() const noexcept {
+        return reinterpret_cast<T*>(Load() & ~kTagMask);
+    }
+    uintptr_t Tag() const noexcept {
+        return Load() & kTagMask;
+    }
+
+    // Modifiers
+    ///////////////////////////////////////////////////////////////////////
+
+    // Returns the old word; the new one carries the old tag
+    template <typename T>
+    uintptr_t SetPointer(T* ptr) noexcept {
+        uintptr_t word = word_.load(std::memory_order_relaxed);
+        while (!word_.compare_exchange_weak(word, Pack(ptr, word), std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+        }
+        return word;
+    }
+    uintptr_t Exchange(uintptr_t word) noexcept {
+        return word_.exchange(word, std::memory_order_acq_rel);
+    }
+
+    void SetTag(uintptr_t tag) noexcept {
+        uintptr_t word = word_.load(std::memory_order_relaxed);
+        while (!word_.compare_exchange_weak(word, (word & ~kTagMask) | (tag & kTagMask),
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+        }
+    }
+    // Sets the tag to `desired` if it is `expected`, else loads it into
+    // `expected`
+    bool CompareExchangeTag(uintptr_t& expected, uintptr_t desired) noexcept {
+        uintptr_t word = word_.load(std::memory_order_relaxed);
+        while (true) {
+            if ((word & kTagMask) != (expected & kTagMask)) {
+                expected = word & kTagMask;
+                return false;
+            }
+            if (word_.compare_exchange_weak(word, (word & ~kTagMask) | (desired & kTagMask),
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+    // Both return the old tag
+    uintptr_t FetchOrTag(uintptr_t bits) noexcept {
+        return word_.fetch_or(bits & kTagMask, std::memory_order_acq_rel) & kTagMask;
+    }
+    uintptr_t FetchAndTag(uintptr_t bits) noexcept {
+        return word_.fetch_and(bits | ~kTagMask, std::memory_order_acq_rel) & kTagMask;
+    }
+};
+
+// `UniquePtr` keeping a `Bits`-bit tag in the pointer, which `alignof(T)`
+// must leave free; no bigger than a `UniquePtr`
+template <typename T, size_t Bits, typename Deleter = Slug<T>>
+class TaggedUniquePtr {
+private:
+    static_assert(!std::is_array_v<T>, "Elements of an array may be less aligned than a tag");
+    static_assert((size_t{1} << Bits) <= alignof(T), "alignof(T) leaves fewer free bits");
+
+    using Word = TaggedWord<Bits>;
+
+    CompressedPair<Word, Deleter> uptr_;
+
+public:
+    static constexpr uintptr_t kTagMask = Word::kTagMask;
+
+    // Constructors
+    ///////////////////////////////////////////////////////////////////////
+
+    TaggedUniquePtr() noexcept : uptr_(uintptr_t{0}, Deleter()) {
+    }
+    TaggedUniquePtr(std::nullptr_t) noexcept : uptr_(uintptr_t{0}, Deleter()) {
+    }
+    explicit TaggedUniquePtr(T* ptr, uintptr_t tag = 0) noexcept
+        : uptr_(Word::Pack(ptr, tag), Deleter()) {
+    }
+    template <typename Del>
+    TaggedUniquePtr(T* ptr, uintptr_t tag, Del&& deleter) noexcept
+        : uptr_(Word::Pack(ptr, tag), std::forward<Del>(deleter)) {
+    }
+    // Takes the tag along
+    TaggedUniquePtr(TaggedUniquePtr&& other) noexcept
+        : uptr_(other.uptr_.GetFirst().Exchange(0), std::move(other.GetDeleter())) {
+    }
+    TaggedUniquePtr(const TaggedUniquePtr&) = delete;
+
+    // `operator=`-s
+    ///////////////////////////////////////////////////////////////////////
+
+    TaggedUniquePtr& operator=(TaggedUniquePtr&& other) noexcept {
+        if (this != &other) {
+            uintptr_t word = other.uptr_.GetFirst().Exchange(0);
+            Destroy(uptr_.GetFirst().Exchange(word));
+            GetDeleter() = std::move(other.GetDeleter());
+        }
+        return *this;
+    }
+    TaggedUniquePtr& operator=(const TaggedUniquePtr&) = delete;
+    TaggedUniquePtr& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    // Destructor
+    ///////////////////////////////////////////////////////////////////////
+
+    ~TaggedUniquePtr() noexcept {
+        static_assert(!std::is_empty_v<Deleter> || std::is_final_v<Deleter> ||
+                          sizeof(TaggedUniquePtr) == sizeof(T*),
+                      "An empty deleter must take no space");
+        Destroy(uptr_.GetFirst().Load());
+    }
+
+    // Modifiers
+    ///////////////////////////////////////////////////////////////////////
+
+    // The tag stays
+    T* Release() noexcept {
+        return Unpack(uptr_.GetFirst().SetPointer(static_cast<T*>(nullptr)));
+    }
+    void Reset(T* ptr = nullptr) noexcept {
+        Destroy(uptr_.GetFirst().SetPointer(ptr));
+    }
+    void Swap(TaggedUniquePtr& other) noexcept {
+        uintptr_t word = uptr_.GetFirst().Exchange(other.uptr_.GetFirst().Load());
+        other.uptr_.GetFirst().Exchange(word);
+        std::swap(GetDeleter(), other.GetDeleter());
+    }
+
+    void SetTag(uintptr_t tag) noexcept {
+        uptr_.GetFirst().SetTag(tag);
+    }
+    bool CompareExchangeTag(uintptr_t& expected, uintptr_t desired) noexcept {
+        return uptr_.GetFirst().CompareExchangeTag(expected, desired);
+    }
+    uintptr_t FetchOrTag(uintptr_t bits) noexcept {
+        return uptr_.GetFirst().FetchOrTag(bits);
+    }
+    uintptr_t FetchAndTag(uintptr_t bits) noexcept {
+        return uptr_.GetFirst().FetchAndTag(bits);
+    }
+
+    // Observers
+    ///////////////////////////////////////////////////////////////////////
+
+    T* Get() const noexcept {
+        return uptr_.GetFirst().template Pointer<T>();
+    }
+    uintptr_t Tag() const noexcept {
+        return uptr_.GetFirst().Tag();
+    }
+    Deleter& GetDeleter() noexcept {
+        return uptr_.GetSecond();
+    }
+    const Deleter& GetDeleter() const noexcept {
+        return uptr_.GetSecond();
+    }
+    explicit operator bool() const noexcept {
+        return Get() != nullptr;
+    }
+
+    typename std::add_lvalue_reference_t<T> operator*() const noexcept {
+        return *Get();
+    }
+    T* operator->() const noexcept {
+        return Get();
+    }
+
+private:
+    static T* Unpack(uintptr_t word) noexcept {
+        return reinterpret_cast<T*>(word & ~kTagMask);
+    }
+    void Destroy(uintptr_t word) noexcept {
+        if (T* ptr = Unpack(word)) {
+            GetDeleter()(ptr);
+        }
+    }
+};
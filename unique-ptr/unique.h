@@ -1,9 +1,12 @@
 #pragma once
 
 #include "compressed_pair.h"
+#include "instrument.h"
+#include "relocate.h"
 
 #include <cstddef>
 #include <type_traits>
+#include <utility>
 
 template <typename T>
 struct Slug {
@@ -33,16 +36,19 @@ public:
     UniquePtr(std::nullptr_t) noexcept : uptr_(nullptr, Deleter()) {
     }
     explicit UniquePtr(T* ptr) noexcept : uptr_(ptr, Deleter()) {
+        RecordIf(ptr, PtrInstrumentation::kMake);
     }
 
     UniquePtr(const UniquePtr&) = delete;
     template <typename Del>
     UniquePtr(T* ptr, Del&& deleter) noexcept : uptr_(ptr, std::forward<Del>(deleter)) {
+        RecordIf(ptr, PtrInstrumentation::kMake);
     }
 
     template <typename U, typename Del>
     UniquePtr(UniquePtr<U, Del>&& other) noexcept
-        : uptr_(other.Release(), std::forward<Del>(other.GetDeleter())) {
+        : uptr_(other.TakePointer(), std::forward<Del>(other.GetDeleter())) {
+        RecordMoveFrom<U>(Get());
     }
 
     // `operator=`-s
@@ -50,13 +56,13 @@ public:
 
     UniquePtr& operator=(const UniquePtr&) = delete;
     UniquePtr& operator=(UniquePtr&& other) noexcept {
-        this->Reset(other.Release());
+        MoveIn<T>(other.TakePointer());
         GetDeleter() = std::forward<Deleter>(other.GetDeleter());
         return *this;
     }
     template <typename U, typename Del>
     UniquePtr& operator=(UniquePtr<U, Del>&& other) noexcept {
-        this->Reset(other.Release());
+        MoveIn<U>(other.TakePointer());
         GetDeleter() = std::forward<Del>(other.GetDeleter());
         return *this;
     }
@@ -69,7 +75,11 @@ public:
     ///////////////////////////////////////////////////////////////////////
 
     ~UniquePtr() noexcept {
+        static_assert(!std::is_empty_v<Deleter> || std::is_final_v<Deleter> ||
+                          sizeof(UniquePtr) == sizeof(T*),
+                      "An empty deleter must take no space");
         if (uptr_.GetFirst()) {
+            RecordIf(Get(), PtrInstrumentation::kRelease);
             GetDeleter()(Get());
         }
     }
@@ -80,12 +90,15 @@ public:
     T* Release() noexcept {
         T* temp = uptr_.GetFirst();
         uptr_.GetFirst() = nullptr;
+        RecordIf(temp, PtrInstrumentation::kRelease);
         return temp;
     }
     void Reset(T* ptr = nullptr) noexcept {
         T* old_ptr = uptr_.GetFirst();
         uptr_.GetFirst() = ptr;
+        RecordIf(ptr, PtrInstrumentation::kMake);
         if (old_ptr) {
+            RecordIf(old_ptr, PtrInstrumentation::kRelease);
             GetDeleter()(old_ptr);
         }
     }
@@ -122,6 +135,46 @@ public:
     T* operator->() const noexcept {
         return uptr_.GetFirst();
     }
+
+private:
+    template <typename U, typename Del>
+    friend class UniquePtr;
+
+    // Moves leave the object uncounted here; the receiver records the move
+    T* TakePointer() noexcept {
+        return std::exchange(uptr_.GetFirst(), nullptr);
+    }
+    // Takes over `ptr`, moved out of a `UniquePtr<U>`, and destroys the
+    // object owned so far
+    template <typename U>
+    void MoveIn(T* ptr) noexcept {
+        T* old_ptr = std::exchange(uptr_.GetFirst(), ptr);
+        RecordMoveFrom<U>(ptr);
+        if (old_ptr) {
+            RecordIf(old_ptr, PtrInstrumentation::kRelease);
+            GetDeleter()(old_ptr);
+        }
+    }
+
+    // Ownership passed on through `Release()` counts as a release and a make
+    static void RecordIf(const T* ptr, PtrInstrumentation::Event event) noexcept {
+        if (ptr) {
+            PtrInstrumentation::Record<T>(event);
+        }
+    }
+    // Between element types a move also hands the live count from one to
+    // the other
+    template <typename U>
+    static void RecordMoveFrom(const T* ptr) noexcept {
+        using From = std::remove_extent_t<U>;
+        if (ptr) {
+            if constexpr (!std::is_same_v<From, T>) {
+                PtrInstrumentation::Record<From>(PtrInstrumentation::kRelease);
+                PtrInstrumentation::Record<T>(PtrInstrumentation::kMake);
+            }
+            PtrInstrumentation::Record<T>(PtrInstrumentation::kMove);
+        }
+    }
 };
 
 // Specialization for arrays
@@ -141,13 +194,16 @@ public:
     UniquePtr(const UniquePtr&) = delete;
     template <typename U>
     explicit UniquePtr(U ptr) noexcept : uptr_(ptr, Deleter()) {
+        RecordIf(Get(), PtrInstrumentation::kMake);
     }
     template <typename U, typename Del>
     UniquePtr(U ptr, Del&& deleter) noexcept : uptr_(ptr, std::forward<Del>(deleter)) {
+        RecordIf(Get(), PtrInstrumentation::kMake);
     }
     template <typename U, typename Del>
     UniquePtr(UniquePtr<U, Del>&& other) noexcept
-        : uptr_(other.Release(), std::forward<Del>(other.GetDeleter())) {
+        : uptr_(other.TakePointer(), std::forward<Del>(other.GetDeleter())) {
+        RecordMoveFrom<U>(Get());
     }
 
     // `operator=`-s
@@ -155,13 +211,13 @@ public:
 
     UniquePtr& operator=(const UniquePtr&) = delete;
     UniquePtr& operator=(UniquePtr&& other) noexcept {
-        this->Reset(other.Release());
+        MoveIn<T>(other.TakePointer());
         GetDeleter() = std::forward<Deleter>(other.GetDeleter());
         return *this;
     }
     template <typename U, typename Del>
     UniquePtr& operator=(UniquePtr<U, Del>&& other) noexcept {
-        this->Reset(other.Release());
+        MoveIn<U>(other.TakePointer());
         GetDeleter() = std::forward<Del>(other.GetDeleter());
         return *this;
     }
@@ -174,7 +230,11 @@ public:
     ///////////////////////////////////////////////////////////////////////
 
     ~UniquePtr() noexcept {
+        static_assert(!std::is_empty_v<Deleter> || std::is_final_v<Deleter> ||
+                          sizeof(UniquePtr) == sizeof(T*),
+                      "An empty deleter must take no space");
         if (uptr_.GetFirst()) {
+            RecordIf(Get(), PtrInstrumentation::kRelease);
             GetDeleter()(Get());
         }
     }
@@ -185,12 +245,15 @@ public:
     T* Release() noexcept {
         T* temp = uptr_.GetFirst();
         uptr_.GetFirst() = nullptr;
+        RecordIf(temp, PtrInstrumentation::kRelease);
         return temp;
     }
     void Reset(T* ptr = nullptr) noexcept {
         T* old_ptr = uptr_.GetFirst();
         uptr_.GetFirst() = ptr;
+        RecordIf(ptr, PtrInstrumentation::kMake);
         if (old_ptr) {
+            RecordIf(old_ptr, PtrInstrumentation::kRelease);
             GetDeleter()(old_ptr);
         }
     }
@@ -233,5 +296,70 @@ public:
     T* operator->() const noexcept {
         return uptr_.GetFirst();
     }
+
+private:
+    template <typename U, typename Del>
+    friend class UniquePtr;
+
+    // Moves leave the object uncounted here; the receiver records the move
+    T* TakePointer() noexcept {
+        return std::exchange(uptr_.GetFirst(), nullptr);
+    }
+    // Takes over `ptr`, moved out of a `UniquePtr<U>`, and destroys the
+    // object owned so far
+    template <typename U>
+    void MoveIn(T* ptr) noexcept {
+        T* old_ptr = std::exchange(uptr_.GetFirst(), ptr);
+        RecordMoveFrom<U>(ptr);
+        if (old_ptr) {
+            RecordIf(old_ptr, PtrInstrumentation::kRelease);
+            GetDeleter()(old_ptr);
+        }
+    }
+
+    // Ownership passed on through `Release()` counts as a release and a make
+    static void RecordIf(const T* ptr, PtrInstrumentation::Event event) noexcept {
+        if (ptr) {
+            PtrInstrumentation::Record<T>(event);
+        }
+    }
+    // Between element types a move also hands the live count from one to
+    // the other
+    template <typename U>
+    static void RecordMoveFrom(const T* ptr) noexcept {
+        using From = std::remove_extent_t<U>;
+        if (ptr) {
+            if constexpr (!std::is_same_v<From, T>) {
+                PtrInstrumentation::Record<From>(PtrInstrumentation::kRelease);
+                PtrInstrumentation::Record<T>(PtrInstrumentation::kMake);
+            }
+            PtrInstrumentation::Record<T>(PtrInstrumentation::kMove);
+        }
+    }
 };
 
+// Nothing refers to a `UniquePtr`'s own address; its deleter decides
+template <typename T, typename Deleter>
+struct IsTriviallyRelocatable<UniquePtr<T, Deleter>> : IsTriviallyRelocatable<Deleter> {};
+
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T>> MakeUnique(Args&&... args) {
+    return UniquePtr<T>(new T{std::forward<Args>(args)...});
+}
+// Elements are value-initialized
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, UniquePtr<T>> MakeUnique(
+    size_t count) {
+    return UniquePtr<T>(new std::remove_extent_t<T>[count]());
+}
+
+// As `MakeUnique`, but default-initialized: trivial types are left unwritten
+template <typename T>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T>> MakeUniqueForOverwrite() {
+    return UniquePtr<T>(new T);
+}
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, UniquePtr<T>>
+MakeUniqueForOverwrite(size_t count) {
+    return UniquePtr<T>(new std::remove_extent_t<T>[count]);
+}